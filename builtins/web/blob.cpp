@@ -452,7 +452,7 @@ bool Blob::append_value(JSContext *cx, HandleObject self, HandleValue val) {
       return blob->append(src, src + len);
     }
 
-    return blob->append(chars.ptr.get(), chars.ptr.get() + chars.len);
+    return blob->append(chars.begin(), chars.end());
   }
 
   // FALLBACK: if we ever get here convert, to string and call append again
@@ -89,7 +89,7 @@ bool SubtleCrypto::importKey(JSContext *cx, unsigned argc, JS::Value *vp) {
     auto format_arg = args.get(0);
     // Convert into a String following https://tc39.es/ecma262/#sec-tostring
     auto format_chars = core::encode(cx, format_arg);
-    if (!format_chars.ptr) {
+    if (!format_chars) {
       return ReturnPromiseRejectedWithPendingError(cx, args);
     }
     std::string_view format_string = format_chars;
@@ -151,7 +151,7 @@ bool fetch_blob(JSContext *cx, HandleObject request_obj, HandleObject response_p
   RootedString blob_url(cx);
 
   // 2. If request's method is not `GET` or blobURLEntry is null, then return a network error.
-  if (std::memcmp(method.ptr.get(), "GET", method.len) != 0) {
+  if (std::memcmp(method.data(), "GET", method.len) != 0) {
     return network_error(cx, response_promise, rval);
   }
 
@@ -164,7 +164,7 @@ bool fetch_blob(JSContext *cx, HandleObject request_obj, HandleObject response_p
   //  N/A
   // 7. Let blob be the result of obtaining a blob object given blobURLEntry and
   // navigationOrEnvironment.
-  std::string url_key(url.ptr.get());
+  std::string url_key(url.data());
   RootedObject blob(cx, url::URL::getObjectURL(url_key));
 
   // 8. If blob is not a Blob object, then return a network error.
@@ -287,7 +287,7 @@ bool fetch_blob(JSContext *cx, HandleObject request_obj, HandleObject response_p
     return false;
   }
 
-  const auto *type_str = (JS::GetStringLength(type) != 0U) ? chars.ptr.get() : "";
+  const auto *type_str = (JS::GetStringLength(type) != 0U) ? chars.data() : "";
   if (!Headers::set_valid_if_undefined(cx, resp_headers, "Content-Type", type_str)) {
     return false;
   }
@@ -353,13 +353,13 @@ bool fetch(JSContext *cx, unsigned argc, Value *vp) {
 
   RootedString method_str(cx, Request::method(request_obj));
   HostString method = core::encode(cx, method_str);
-  if (!method.ptr) {
+  if (!method) {
     return ReturnPromiseRejectedWithPendingError(cx, args);
   }
 
   RootedValue url_val(cx, RequestOrResponse::url(request_obj));
   HostString url = core::encode(cx, url_val);
-  if (!url.ptr) {
+  if (!url) {
     return ReturnPromiseRejectedWithPendingError(cx, args);
   }
 
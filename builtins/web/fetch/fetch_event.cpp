@@ -489,7 +489,15 @@ static void dispatch_fetch_event(HandleObject event, double *total_compute) {
   RootedObject event_target(ENGINE->cx(), global_event_target());
   MOZ_RELEASE_ASSERT(event_target);
 
+  // Compute time is only reported along with the event loop metrics, so it's only measured then.
+  if (!ENGINE->dump_event_loop_metrics_enabled()) {
+    EventTarget::dispatch_event(ENGINE->cx(), event_target, event_val, &rval);
+    return;
+  }
+
+  auto start = host_api::MonotonicClock::now();
   EventTarget::dispatch_event(ENGINE->cx(), event_target, event_val, &rval);
+  *total_compute += static_cast<double>(host_api::MonotonicClock::now() - start) / 1000;
 }
 
 bool handle_incoming_request(host_api::HttpIncomingRequest *request) {
@@ -506,17 +514,24 @@ bool handle_incoming_request(host_api::HttpIncomingRequest *request) {
     return false;
   }
 
+  // Time spent running JS for this request, in microseconds.
   double total_compute = 0;
+  ENGINE->reset_event_loop_metrics();
 
   content_debugger::maybe_init_debugger(ENGINE, true);
   dispatch_fetch_event(fetch_event, &total_compute);
 
-  bool success = ENGINE->run_event_loop();
+  bool success = ENGINE->run_event_loop(&total_compute);
 
   if (JS_IsExceptionPending(ENGINE->cx())) {
     ENGINE->dump_pending_exception("evaluating incoming request");
   }
 
+  if (ENGINE->dump_event_loop_metrics_enabled()) {
+    fprintf(stderr, "Request compute time: %.0fus\n", total_compute);
+    ENGINE->dump_event_loop_metrics();
+  }
+
   if (!success) {
     fprintf(stderr, "Warning: JS event loop terminated without completing the request.\n");
   }
@@ -0,0 +1,167 @@
+#include "header-names.h"
+
+#include <algorithm>
+#include <array>
+
+namespace builtins::web::fetch {
+namespace {
+
+// Must be kept sorted, since ids are used to order interned names.
+constexpr std::array<std::string_view, 66> WELL_KNOWN_HEADER_NAMES = {
+    "accept",
+    "accept-charset",
+    "accept-encoding",
+    "accept-language",
+    "accept-ranges",
+    "access-control-allow-credentials",
+    "access-control-allow-headers",
+    "access-control-allow-methods",
+    "access-control-allow-origin",
+    "access-control-expose-headers",
+    "access-control-max-age",
+    "access-control-request-headers",
+    "access-control-request-method",
+    "age",
+    "allow",
+    "authorization",
+    "cache-control",
+    "connection",
+    "content-disposition",
+    "content-encoding",
+    "content-language",
+    "content-length",
+    "content-location",
+    "content-range",
+    "content-security-policy",
+    "content-type",
+    "cookie",
+    "date",
+    "etag",
+    "expect",
+    "expires",
+    "forwarded",
+    "host",
+    "http2-settings",
+    "if-match",
+    "if-modified-since",
+    "if-none-match",
+    "if-range",
+    "if-unmodified-since",
+    "keep-alive",
+    "last-modified",
+    "link",
+    "location",
+    "origin",
+    "pragma",
+    "proxy-authenticate",
+    "proxy-authorization",
+    "proxy-connection",
+    "range",
+    "referer",
+    "referrer-policy",
+    "retry-after",
+    "server",
+    "set-cookie",
+    "strict-transport-security",
+    "te",
+    "trailer",
+    "transfer-encoding",
+    "upgrade",
+    "user-agent",
+    "vary",
+    "via",
+    "www-authenticate",
+    "x-content-type-options",
+    "x-forwarded-for",
+    "x-request-id",
+};
+
+static_assert(std::is_sorted(WELL_KNOWN_HEADER_NAMES.begin(), WELL_KNOWN_HEADER_NAMES.end()));
+static_assert(WELL_KNOWN_HEADER_NAMES.size() < UINT8_MAX);
+
+constexpr char ascii_lowercase(const char c) { return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c; }
+
+// FNV-1a over the lowercased name.
+constexpr uint32_t hash_name(std::string_view name, uint32_t seed) {
+  uint32_t hash = 2166136261U ^ seed;
+  for (char c : name) {
+    hash ^= static_cast<uint8_t>(ascii_lowercase(c));
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+constexpr size_t TABLE_BITS = 10;
+constexpr size_t TABLE_SIZE = 1 << TABLE_BITS;
+
+constexpr size_t table_slot(uint32_t hash) { return hash >> (32 - TABLE_BITS); }
+
+// Finds a seed for which all well-known names hash to distinct table slots, making the table a
+// perfect hash: a lookup is a single probe, followed by a comparison to rule out unknown names.
+constexpr uint32_t find_perfect_hash_seed() {
+  for (uint32_t seed = 0; seed < 1000; seed++) {
+    std::array<bool, TABLE_SIZE> used = {};
+    bool collision = false;
+    for (auto name : WELL_KNOWN_HEADER_NAMES) {
+      auto slot = table_slot(hash_name(name, seed));
+      if (used[slot]) {
+        collision = true;
+        break;
+      }
+      used[slot] = true;
+    }
+    if (!collision) {
+      return seed;
+    }
+  }
+  return UINT32_MAX;
+}
+
+constexpr uint32_t PERFECT_HASH_SEED = find_perfect_hash_seed();
+static_assert(PERFECT_HASH_SEED != UINT32_MAX, "No perfect hash seed found for header names");
+
+constexpr std::array<uint8_t, TABLE_SIZE> build_table() {
+  std::array<uint8_t, TABLE_SIZE> table = {};
+  for (size_t i = 0; i < WELL_KNOWN_HEADER_NAMES.size(); i++) {
+    table[table_slot(hash_name(WELL_KNOWN_HEADER_NAMES[i], PERFECT_HASH_SEED))] = i + 1;
+  }
+  return table;
+}
+
+constexpr std::array<uint8_t, TABLE_SIZE> WELL_KNOWN_HEADER_TABLE = build_table();
+
+uint8_t lookup(std::string_view name, uint32_t hash) {
+  uint8_t id = WELL_KNOWN_HEADER_TABLE[table_slot(hash)];
+  if (id == 0) {
+    return 0;
+  }
+  auto candidate = WELL_KNOWN_HEADER_NAMES[id - 1];
+  if (candidate.size() != name.size()) {
+    return 0;
+  }
+  for (size_t i = 0; i < name.size(); i++) {
+    if (ascii_lowercase(name[i]) != candidate[i]) {
+      return 0;
+    }
+  }
+  return id;
+}
+
+} // namespace
+
+HeaderNameKey HeaderNameKey::from(std::string_view name) {
+  HeaderNameKey key;
+  key.hash = hash_name(name, PERFECT_HASH_SEED);
+  key.id = lookup(name, key.hash);
+  return key;
+}
+
+uint8_t well_known_header_id(std::string_view name) {
+  return lookup(name, hash_name(name, PERFECT_HASH_SEED));
+}
+
+std::string_view well_known_header_name(uint8_t id) {
+  return id == 0 ? std::string_view() : WELL_KNOWN_HEADER_NAMES[id - 1];
+}
+
+} // namespace builtins::web::fetch
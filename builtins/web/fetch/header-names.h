@@ -0,0 +1,37 @@
+#ifndef BUILTINS_WEB_FETCH_HEADER_NAMES_H
+#define BUILTINS_WEB_FETCH_HEADER_NAMES_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace builtins::web::fetch {
+
+/**
+ * A header name, reduced to what's needed to compare it to other header names cheaply.
+ *
+ * Well-known header names, such as `content-type` or `set-cookie`, are interned: they get a
+ * non-zero `id`, which is their 1-based position in a table sorted by lowercase name. That means
+ * two interned names can be ordered by comparing their ids. All names, interned or not, also get a
+ * case-insensitive hash, so that most comparisons of distinct names never look at their bytes.
+ */
+struct HeaderNameKey {
+  uint32_t hash = 0;
+  uint8_t id = 0;
+
+  static HeaderNameKey from(std::string_view name);
+};
+
+/**
+ * Returns the interned id of the given header name, compared case-insensitively, or 0 if it isn't
+ * a well-known header name.
+ */
+uint8_t well_known_header_id(std::string_view name);
+
+/**
+ * Returns the lowercase name for the given interned id.
+ */
+std::string_view well_known_header_name(uint8_t id);
+
+} // namespace builtins::web::fetch
+
+#endif // BUILTINS_WEB_FETCH_HEADER_NAMES_H
@@ -0,0 +1,124 @@
+#include "header-scan.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+namespace builtins::web::fetch {
+namespace {
+
+constexpr std::array<char, 128> VALID_NAME_CHARS = {
+    0, 0, 0, 0, 0, 0, 0, 0, //   0
+    0, 0, 0, 0, 0, 0, 0, 0, //   8
+    0, 0, 0, 0, 0, 0, 0, 0, //  16
+    0, 0, 0, 0, 0, 0, 0, 0, //  24
+
+    0, 1, 0, 1, 1, 1, 1, 1, //  32
+    0, 0, 1, 1, 0, 1, 1, 0, //  40
+    1, 1, 1, 1, 1, 1, 1, 1, //  48
+    1, 1, 0, 0, 0, 0, 0, 0, //  56
+
+    0, 1, 1, 1, 1, 1, 1, 1, //  64
+    1, 1, 1, 1, 1, 1, 1, 1, //  72
+    1, 1, 1, 1, 1, 1, 1, 1, //  80
+    1, 1, 1, 0, 0, 0, 1, 1, //  88
+
+    1, 1, 1, 1, 1, 1, 1, 1, //  96
+    1, 1, 1, 1, 1, 1, 1, 1, // 104
+    1, 1, 1, 1, 1, 1, 1, 1, // 112
+    1, 1, 1, 0, 1, 0, 1, 0  // 120
+};
+
+#ifdef __wasm_simd128__
+// For each low nibble, a bitmask of the high nibbles that form a token char together with it. Only
+// high nibbles 0-7 can, since token chars are ASCII.
+constexpr std::array<uint8_t, 16> build_name_char_rows() {
+  std::array<uint8_t, 16> rows = {};
+  for (size_t ch = 0; ch < VALID_NAME_CHARS.size(); ch++) {
+    if (VALID_NAME_CHARS[ch]) {
+      rows[ch & 0xF] |= 1 << (ch >> 4);
+    }
+  }
+  return rows;
+}
+
+constexpr std::array<uint8_t, 16> NAME_CHAR_ROWS = build_name_char_rows();
+#else
+constexpr uint64_t ONES = 0x0101010101010101ULL;
+constexpr uint64_t HIGHS = 0x8080808080808080ULL;
+
+// Returns a word with the high bit set in every byte of `word` that equals `byte`, and possibly
+// in bytes after the first match.
+constexpr uint64_t match_bytes(uint64_t word, uint8_t byte) {
+  uint64_t x = word ^ (ONES * byte);
+  return (x - ONES) & ~x & HIGHS;
+}
+#endif
+
+} // namespace
+
+bool is_header_name_char(unsigned char ch) { return ch < 128 && VALID_NAME_CHARS[ch]; }
+
+bool is_valid_header_name(const char *chars, size_t len) {
+  size_t i = 0;
+#ifdef __wasm_simd128__
+  // Look up each byte's low nibble to get the valid high nibbles, and check its high nibble's bit.
+  // Bytes above 127 have high nibbles for which the swizzle yields 0, so they always fail.
+  const v128_t rows = wasm_v128_load(NAME_CHAR_ROWS.data());
+  const v128_t bits = wasm_u8x16_const(1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0, 0);
+  const v128_t low_nibble = wasm_u8x16_splat(0x0F);
+  for (; i + 16 <= len; i += 16) {
+    v128_t v = wasm_v128_load(chars + i);
+    v128_t row = wasm_i8x16_swizzle(rows, wasm_v128_and(v, low_nibble));
+    v128_t bit = wasm_i8x16_swizzle(bits, wasm_u8x16_shr(v, 4));
+    if (!wasm_i8x16_all_true(wasm_v128_and(row, bit))) {
+      return false;
+    }
+  }
+#endif
+  for (; i < len; i++) {
+    if (!is_header_name_char(chars[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t find_invalid_header_value_byte(const char *chars, size_t len) {
+  size_t i = 0;
+#ifdef __wasm_simd128__
+  const v128_t cr = wasm_u8x16_splat('\r');
+  const v128_t lf = wasm_u8x16_splat('\n');
+  const v128_t nul = wasm_u8x16_splat(0);
+  for (; i + 16 <= len; i += 16) {
+    v128_t v = wasm_v128_load(chars + i);
+    v128_t matches = wasm_v128_or(wasm_v128_or(wasm_i8x16_eq(v, cr), wasm_i8x16_eq(v, lf)),
+                                  wasm_i8x16_eq(v, nul));
+    if (wasm_v128_any_true(matches)) {
+      return i + __builtin_ctz(wasm_i8x16_bitmask(matches));
+    }
+  }
+#else
+  // Skip ahead a word at a time, and leave finding the exact position to the byte loop below.
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word = 0;
+    std::memcpy(&word, chars + i, sizeof(word));
+    if (match_bytes(word, '\r') | match_bytes(word, '\n') | match_bytes(word, 0)) {
+      break;
+    }
+  }
+#endif
+  for (; i < len; i++) {
+    char ch = chars[i];
+    if (ch == '\r' || ch == '\n' || ch == '\0') {
+      return i;
+    }
+  }
+  return len;
+}
+
+} // namespace builtins::web::fetch
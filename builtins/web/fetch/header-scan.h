@@ -0,0 +1,34 @@
+#ifndef BUILTINS_WEB_FETCH_HEADER_SCAN_H
+#define BUILTINS_WEB_FETCH_HEADER_SCAN_H
+
+#include <cstddef>
+
+namespace builtins::web::fetch {
+
+/**
+ * Scanning kernels for header validation.
+ *
+ * If the build targets wasm SIMD128, these process 16 bytes at a time, and otherwise fall back to
+ * scalar code that still checks a word at a time where possible. Large cookie and CSP values are
+ * the main beneficiaries.
+ */
+
+/**
+ * Returns whether `ch` is a token char, and as such valid in header names.
+ */
+bool is_header_name_char(unsigned char ch);
+
+/**
+ * Returns whether all of the given bytes are token chars.
+ */
+bool is_valid_header_name(const char *chars, size_t len);
+
+/**
+ * Returns the index of the first CR, LF or NUL byte in the given header value, or `len` if there
+ * is none.
+ */
+size_t find_invalid_header_value_byte(const char *chars, size_t len);
+
+} // namespace builtins::web::fetch
+
+#endif // BUILTINS_WEB_FETCH_HEADER_SCAN_H
@@ -3,36 +3,15 @@
 #include "decode.h"
 #include "encode.h"
 #include "fetch-errors.h"
+#include "header-scan.h"
 #include "sequence.hpp"
 
 #include "js/Conversions.h"
-#include <numeric>
+#include <algorithm>
 
 namespace builtins::web::fetch {
 namespace {
 
-const std::array<char, 128> VALID_NAME_CHARS = {
-    0, 0, 0, 0, 0, 0, 0, 0, //   0
-    0, 0, 0, 0, 0, 0, 0, 0, //   8
-    0, 0, 0, 0, 0, 0, 0, 0, //  16
-    0, 0, 0, 0, 0, 0, 0, 0, //  24
-
-    0, 1, 0, 1, 1, 1, 1, 1, //  32
-    0, 0, 1, 1, 0, 1, 1, 0, //  40
-    1, 1, 1, 1, 1, 1, 1, 1, //  48
-    1, 1, 0, 0, 0, 0, 0, 0, //  56
-
-    0, 1, 1, 1, 1, 1, 1, 1, //  64
-    1, 1, 1, 1, 1, 1, 1, 1, //  72
-    1, 1, 1, 1, 1, 1, 1, 1, //  80
-    1, 1, 1, 0, 0, 0, 1, 1, //  88
-
-    1, 1, 1, 1, 1, 1, 1, 1, //  96
-    1, 1, 1, 1, 1, 1, 1, 1, // 104
-    1, 1, 1, 1, 1, 1, 1, 1, // 112
-    1, 1, 1, 0, 1, 0, 1, 0  // 120
-};
-
 host_api::HostString set_cookie_str;
 
 host_api::HttpHeadersReadOnly *get_handle(JSObject *self) {
@@ -78,16 +57,13 @@ bool normalize_header_value(host_api::HostString &value) {
     }
   }
 
-  for (size_t i = start; i < end; i++) {
-    unsigned char ch = value_chars[i];
-    if (ch == '\r' || ch == '\n' || ch == '\0') {
-      return false;
-    }
+  if (find_invalid_header_value_byte(value_chars + start, end - start) != end - start) {
+    return false;
   }
 
   if (start != 0 || end != value.len) {
     memmove(value_chars, value_chars + start, end - start);
-    value.len = end - start;
+    value.truncate(end - start);
   }
 
   return true;
@@ -96,7 +72,7 @@ bool normalize_header_value(host_api::HostString &value) {
 host_api::HostString normalize_and_validate_header_value(JSContext *cx, HandleValue value_val,
                                                          const char *fun_name) {
   host_api::HostString value = core::encode_byte_string(cx, value_val);
-  if (!value.ptr) {
+  if (!value) {
     return value;
   }
   bool valid = normalize_header_value(value);
@@ -115,8 +91,10 @@ host_api::HostString normalize_and_validate_header_value(JSContext *cx, HandleVa
   return value;
 }
 
-const std::vector<const char *> *forbidden_request_headers;
-const std::vector<const char *> *forbidden_response_headers;
+// Indexed by interned header name id.
+using ForbiddenHeaders = std::array<bool, UINT8_MAX + 1>;
+ForbiddenHeaders forbidden_request_headers;
+ForbiddenHeaders forbidden_response_headers;
 
 enum class Ordering : uint8_t { Less, Equal, Greater };
 
@@ -143,11 +121,28 @@ inline Ordering header_compare(const std::string_view a, const std::string_view
   return Ordering::Greater;
 }
 
-struct HeaderCompare {
-  bool operator()(const std::string_view a, const std::string_view b) {
-    return header_compare(a, b) == Ordering::Less;
+// Interned names are ordered by their ids, so only names that aren't both interned need to be
+// compared byte by byte.
+inline Ordering header_compare(const HeaderNameKey &key_a, const std::string_view a,
+                               const HeaderNameKey &key_b, const std::string_view b) {
+  if (key_a.id != 0 && key_b.id != 0) {
+    if (key_a.id == key_b.id) {
+      return Ordering::Equal;
+    }
+    return key_a.id < key_b.id ? Ordering::Less : Ordering::Greater;
   }
-};
+  return header_compare(a, b);
+}
+
+// A name can only be equal to an interned name if it's interned, too. Otherwise, differing hashes
+// rule out equality without looking at the names.
+inline bool header_equals(const HeaderNameKey &key_a, const std::string_view a,
+                          const HeaderNameKey &key_b, const std::string_view b) {
+  if (key_a.id != 0 || key_b.id != 0) {
+    return key_a.id == key_b.id;
+  }
+  return key_a.hash == key_b.hash && header_compare(a, b) == Ordering::Equal;
+}
 
 class HeadersSortListCompare {
   const Headers::HeadersList *headers_;
@@ -155,100 +150,114 @@ class HeadersSortListCompare {
 public:
   HeadersSortListCompare(const Headers::HeadersList *headers) : headers_(headers) {}
 
-  bool operator()(size_t a, size_t b) {
-    const auto *header_a = &std::get<0>(headers_->at(a));
-    const auto *header_b = &std::get<0>(headers_->at(b));
-    return header_compare(*header_a, *header_b) == Ordering::Less;
+  bool operator()(const Headers::HeadersSortEntry &a, const Headers::HeadersSortEntry &b) {
+    const auto &header_a = std::get<0>(headers_->at(a.index));
+    const auto &header_b = std::get<0>(headers_->at(b.index));
+    return header_compare(a.key, header_a, b.key, header_b) == Ordering::Less;
   }
 };
 
 class HeadersSortListLookupCompare {
   const Headers::HeadersList *headers_;
+  const HeaderNameKey &key_;
 
 public:
-  HeadersSortListLookupCompare(const Headers::HeadersList *headers) : headers_(headers) {}
+  HeadersSortListLookupCompare(const Headers::HeadersList *headers, const HeaderNameKey &key)
+      : headers_(headers), key_(key) {}
 
-  bool operator()(size_t a, string_view b) {
-    const auto *header_a = &std::get<0>(headers_->at(a));
-    return header_compare(*header_a, b) == Ordering::Less;
+  bool operator()(const Headers::HeadersSortEntry &a, string_view b) {
+    const auto &header_a = std::get<0>(headers_->at(a.index));
+    return header_compare(a.key, header_a, key_, b) == Ordering::Less;
   }
 };
 
 JS::PersistentRooted<JSString *> comma;
 
-bool retrieve_value_for_header_from_handle(JSContext *cx, JS::HandleObject self,
-                                           const host_api::HostString &name,
-                                           MutableHandleValue value) {
-  auto *handle = get_handle(self);
-  auto ret = handle->get(name);
-
-  if (const auto *err = ret.to_err()) {
-    HANDLE_ERROR(cx, *err);
-    return false;
+// Materialized header values are cached per sort list index, in an array held in the `ValueCache`
+// slot. The cache is dropped on every modification, which is what can shift the indices.
+JSString *cached_value(JSContext *cx, JS::HandleObject self, size_t index) {
+  JS::Value cache_val = JS::GetReservedSlot(self, static_cast<uint32_t>(Headers::Slots::ValueCache));
+  if (cache_val.isUndefined()) {
+    return nullptr;
   }
-
-  auto &values = ret.unwrap();
-  if (!values.has_value()) {
-    value.setNull();
-    return true;
+  JS::RootedObject cache(cx, &cache_val.toObject());
+  JS::RootedValue cached(cx);
+  if (!JS_GetElement(cx, cache, index, &cached)) {
+    return nullptr;
   }
+  return cached.isString() ? cached.toString() : nullptr;
+}
 
-  RootedString res_str(cx);
-  RootedString val_str(cx);
-  for (auto &str : values.value()) {
-    val_str = core::decode_byte_string(cx, str);
-    if (!val_str) {
+bool cache_value(JSContext *cx, JS::HandleObject self, size_t index, JS::HandleString str) {
+  JS::Value cache_val = JS::GetReservedSlot(self, static_cast<uint32_t>(Headers::Slots::ValueCache));
+  JS::RootedObject cache(cx);
+  if (cache_val.isUndefined()) {
+    cache = JS::NewArrayObject(cx, Headers::headers_list(self)->size());
+    if (!cache) {
       return false;
     }
-
-    if (!res_str) {
-      res_str = val_str;
-    } else {
-      res_str = JS_ConcatStrings(cx, res_str, comma);
-      if (!res_str) {
-        return false;
-      }
-      res_str = JS_ConcatStrings(cx, res_str, val_str);
-      if (!res_str) {
-        return false;
-      }
-    }
+    JS::SetReservedSlot(self, static_cast<uint32_t>(Headers::Slots::ValueCache),
+                        JS::ObjectValue(*cache));
+  } else {
+    cache = &cache_val.toObject();
   }
-
-  value.setString(res_str);
-  return true;
+  return JS_SetElement(cx, cache, index, str);
 }
 
-// for getSetCookie
-bool retrieve_values_for_header_from_handle(JSContext *cx, JS::HandleObject self,
-                                            const host_api::HostString &name,
-                                            JS::MutableHandleObject out_arr) {
-  auto *handle = get_handle(self);
-  auto ret = handle->get(name);
-
-  if (const auto *err = ret.to_err()) {
-    HANDLE_ERROR(cx, *err);
-    return false;
+// Walk through the repeated values for a given header, updating the index
+void skip_values_for_header_from_list(JSContext *cx, JS::HandleObject self, size_t *index,
+                                      bool is_iterator) {
+  MOZ_ASSERT(Headers::is_instance(self));
+  Headers::HeadersList *headers_list = Headers::headers_list(self);
+  const host_api::HostString *key = &std::get<0>(*Headers::get_index(cx, self, *index));
+  size_t len = headers_list->size();
+  while (*index + 1 < len) {
+    const host_api::HostString *next_key = &std::get<0>(*Headers::get_index(cx, self, *index + 1));
+    // iterator doesn't join set-cookie
+    if (is_iterator && header_compare(*key, set_cookie_str) == Ordering::Equal) {
+      break;
+    }
+    if (header_compare(*next_key, *key) != Ordering::Equal) {
+      break;
+    }
+    *index = *index + 1;
   }
+}
 
-  auto &values = ret.unwrap();
-  if (!values.has_value()) {
+// Get the array of `set-cookie` values, which are never combined. The array is kept in the
+// `SetCookieCache` slot until the next modification, so that `getSetCookie` and iteration don't
+// have to walk the list and create new strings each time. It mustn't be handed out to content.
+bool set_cookie_values(JSContext *cx, JS::HandleObject self, JS::MutableHandleObject values) {
+  MOZ_ASSERT(Headers::is_instance(self));
+  JS::Value cache_val =
+      JS::GetReservedSlot(self, static_cast<uint32_t>(Headers::Slots::SetCookieCache));
+  if (!cache_val.isUndefined()) {
+    values.set(&cache_val.toObject());
     return true;
   }
 
-  RootedString val_str(cx);
-  size_t i = 0;
-  for (auto &str : values.value()) {
-    val_str = core::decode_byte_string(cx, str);
-    if (!val_str) {
-      return false;
-    }
-    if (!JS_SetElement(cx, out_arr, i, val_str)) {
-      return false;
+  JS::RootedValueVector strings(cx);
+  auto idx = Headers::lookup(cx, self, set_cookie_str);
+  if (idx) {
+    size_t len = Headers::headers_list(self)->size();
+    for (size_t i = idx.value(); i < len; i++) {
+      auto *const entry = Headers::get_index(cx, self, i);
+      if (header_compare(std::get<0>(*entry), set_cookie_str) != Ordering::Equal) {
+        break;
+      }
+      JSString *str = core::decode_byte_string(cx, std::get<1>(*entry));
+      if (!str || !strings.append(JS::StringValue(str))) {
+        return false;
+      }
     }
-    i++;
   }
 
+  values.set(JS::NewArrayObject(cx, strings));
+  if (!values) {
+    return false;
+  }
+  JS::SetReservedSlot(self, static_cast<uint32_t>(Headers::Slots::SetCookieCache),
+                      JS::ObjectValue(*values));
   return true;
 }
 
@@ -260,16 +269,31 @@ bool retrieve_value_for_header_from_list(JSContext *cx, JS::HandleObject self, s
   auto *const entry = Headers::get_index(cx, self, *index);
   const host_api::HostString *key = &std::get<0>(*entry);
   const host_api::HostString *val = &std::get<1>(*entry);
+
+  // iterator doesn't join set-cookie, only get
+  if (is_iterator && header_compare(*key, set_cookie_str) == Ordering::Equal) {
+    JS::RootedObject values(cx);
+    if (!set_cookie_values(cx, self, &values)) {
+      return false;
+    }
+    // set-cookie entries are contiguous in the sort list, so the offset from the first one is the
+    // index into the cached values.
+    size_t first = Headers::lookup(cx, self, set_cookie_str).value();
+    return JS_GetElement(cx, values, *index - first, value);
+  }
+
+  size_t first_index = *index;
+  if (JSString *cached = cached_value(cx, self, first_index)) {
+    value.setString(cached);
+    skip_values_for_header_from_list(cx, self, index, is_iterator);
+    return true;
+  }
+
   // check if we need to join with the next value if it is the same key, comma-separated
   RootedString str(cx, core::decode_byte_string(cx, *val));
   if (!str) {
     return false;
   }
-  // iterator doesn't join set-cookie, only get
-  if (is_iterator && header_compare(*key, set_cookie_str) == Ordering::Equal) {
-    value.setString(str);
-    return true;
-  }
   size_t len = headers_list->size();
   while (*index + 1 < len) {
     auto *const entry = Headers::get_index(cx, self, *index + 1);
@@ -292,64 +316,13 @@ bool retrieve_value_for_header_from_list(JSContext *cx, JS::HandleObject self, s
     }
     *index = *index + 1;
   }
-  value.setString(str);
-  return true;
-}
-
-// Get the array of values for a given header (set-cookie, this is only for set-cookie)
-bool retrieve_values_for_header_from_list(JSContext *cx, JS::HandleObject self, size_t index,
-                                          JS::MutableHandleObject out_arr) {
-  MOZ_ASSERT(Headers::is_instance(self));
-  Headers::HeadersList *headers_list = Headers::headers_list(self);
-  const host_api::HostString *key = &std::get<0>(*Headers::get_index(cx, self, index));
-  const host_api::HostString *val = &std::get<1>(*Headers::get_index(cx, self, index));
-  // check if we need to join with the next value if it is the same key
-  RootedString str(cx, core::decode_byte_string(cx, *val));
-  if (!str) {
-    return false;
-  }
-  size_t i = 0;
-  size_t len = headers_list->size();
-  if (!JS_SetElement(cx, out_arr, i, str)) {
+  if (!cache_value(cx, self, first_index, str)) {
     return false;
   }
-  while (++i < len - index) {
-    const host_api::HostString *next_key = &std::get<0>(*Headers::get_index(cx, self, index + i));
-    val = &std::get<1>(*Headers::get_index(cx, self, index + i));
-    if (header_compare(*next_key, *key) != Ordering::Equal) {
-      break;
-    }
-    str = core::decode_byte_string(cx, *val);
-    if (!str) {
-      return false;
-    }
-    if (!JS_SetElement(cx, out_arr, i, str)) {
-      return false;
-    }
-  }
+  value.setString(str);
   return true;
 }
 
-// Walk through the repeated values for a given header, updating the index
-void skip_values_for_header_from_list(JSContext *cx, JS::HandleObject self, size_t *index,
-                                      bool is_iterator) {
-  MOZ_ASSERT(Headers::is_instance(self));
-  Headers::HeadersList *headers_list = Headers::headers_list(self);
-  const host_api::HostString *key = &std::get<0>(*Headers::get_index(cx, self, *index));
-  size_t len = headers_list->size();
-  while (*index + 1 < len) {
-    const host_api::HostString *next_key = &std::get<0>(*Headers::get_index(cx, self, *index + 1));
-    // iterator doesn't join set-cookie
-    if (is_iterator && header_compare(*key, set_cookie_str) == Ordering::Equal) {
-      break;
-    }
-    if (header_compare(*next_key, *key) != Ordering::Equal) {
-      break;
-    }
-    *index = *index + 1;
-  }
-}
-
 bool validate_guard(JSContext *cx, HandleObject self, string_view header_name, const char *fun_name,
                     bool *is_valid) {
   MOZ_ASSERT(Headers::is_instance(self));
@@ -363,75 +336,132 @@ bool validate_guard(JSContext *cx, HandleObject self, string_view header_name, c
   case Headers::HeadersGuard::Immutable:
     return api::throw_error(cx, FetchErrors::HeadersImmutable, fun_name);
   case Headers::HeadersGuard::Request:
-    for (const auto *forbidden_header_name : *forbidden_request_headers) {
-      if (header_compare(header_name, forbidden_header_name) == Ordering::Equal) {
-        *is_valid = false;
-        return true;
-      }
-    }
-    *is_valid = true;
+    *is_valid = !forbidden_request_headers[well_known_header_id(header_name)];
     return true;
   case Headers::HeadersGuard::Response:
-    for (const auto *forbidden_header_name : *forbidden_response_headers) {
-      if (header_compare(header_name, forbidden_header_name) == Ordering::Equal) {
-        *is_valid = false;
-        return true;
-      }
-    }
-    *is_valid = true;
+    *is_valid = !forbidden_response_headers[well_known_header_id(header_name)];
     return true;
   default:
     MOZ_ASSERT_UNREACHABLE();
   }
 }
 
-// Update the sort list
+// Update the sort list. This is only needed after the headers list was replaced wholesale: all
+// other modifications keep the sort list up to date incrementally.
 void ensure_updated_sort_list(const Headers::HeadersList *headers_list,
-                              std::vector<size_t> *headers_sort_list) {
+                              Headers::HeadersSortList *headers_sort_list) {
   MOZ_ASSERT(headers_list);
   MOZ_ASSERT(headers_sort_list);
   // Empty length means we need to recompute.
   if (headers_sort_list->empty()) {
-    headers_sort_list->resize(headers_list->size());
-    std::iota(headers_sort_list->begin(), headers_sort_list->end(), 0);
-    std::sort(headers_sort_list->begin(), headers_sort_list->end(),
-              HeadersSortListCompare(headers_list));
+    headers_sort_list->reserve(headers_list->size());
+    for (size_t i = 0; i < headers_list->size(); i++) {
+      headers_sort_list->push_back({i, HeaderNameKey::from(std::get<0>(headers_list->at(i)))});
+    }
+    // Stable, so that entries with equal names stay in insertion order.
+    std::stable_sort(headers_sort_list->begin(), headers_sort_list->end(),
+                     HeadersSortListCompare(headers_list));
   }
 
   MOZ_ASSERT(headers_sort_list->size() == headers_list->size());
 }
 
-// Clear the sort list, marking it as mutated so it will be recomputed on the next lookup.
-void mark_for_sort(JS::HandleObject self) {
+// Add the last entry of the headers list to the sort list, after all entries with the same name.
+// If the sort list hasn't been computed yet, it's left for the next lookup to compute.
+void insert_last_into_sort_list(JS::HandleObject self) {
   MOZ_ASSERT(Headers::is_instance(self));
-  std::vector<size_t> *headers_sort_list = Headers::headers_sort_list(self);
-  headers_sort_list->clear();
+  const Headers::HeadersList *headers_list = Headers::headers_list(self);
+  Headers::HeadersSortList *headers_sort_list = Headers::headers_sort_list(self);
+  if (headers_sort_list->size() + 1 != headers_list->size()) {
+    MOZ_ASSERT(headers_sort_list->empty());
+    return;
+  }
+
+  size_t index = headers_list->size() - 1;
+  Headers::HeadersSortEntry entry{index, HeaderNameKey::from(std::get<0>(headers_list->at(index)))};
+  auto it = std::upper_bound(headers_sort_list->begin(), headers_sort_list->end(), entry,
+                             HeadersSortListCompare(headers_list));
+  headers_sort_list->insert(it, entry);
 }
 
-bool append_valid_normalized_header(JSContext *cx, HandleObject self, string_view header_name,
-                                    string_view header_val) {
-  Headers::Mode mode = Headers::mode(self);
-  if (mode == Headers::Mode::HostOnly) {
-    auto *handle = get_handle(self)->as_writable();
-    MOZ_ASSERT(handle);
-    auto res = handle->append(header_name, header_val);
-    if (const auto *err = res.to_err()) {
-      HANDLE_ERROR(cx, *err);
-      return false;
+// Returns the end of the range of sort list entries with the same name as the one at `index`.
+size_t end_of_name_range(const Headers::HeadersList *headers_list,
+                         const Headers::HeadersSortList *headers_sort_list, size_t index) {
+  const auto &first = headers_sort_list->at(index);
+  const auto &name = std::get<0>(headers_list->at(first.index));
+  size_t end = index + 1;
+  while (end < headers_sort_list->size()) {
+    const auto &entry = headers_sort_list->at(end);
+    if (!header_equals(entry.key, std::get<0>(headers_list->at(entry.index)), first.key, name)) {
+      break;
     }
-  } else {
-    MOZ_ASSERT(mode == Headers::Mode::ContentOnly);
+    end++;
+  }
+  return end;
+}
 
-    Headers::HeadersList *list = Headers::headers_list(self);
+// Remove the entries in the given range of the sort list from both the headers list and the sort
+// list, keeping the latter up to date.
+void erase_sorted_range(JS::HandleObject self, size_t start, size_t end) {
+  MOZ_ASSERT(Headers::is_instance(self));
+  Headers::HeadersList *headers_list = Headers::headers_list(self);
+  Headers::HeadersSortList *headers_sort_list = Headers::headers_sort_list(self);
+  MOZ_ASSERT(headers_sort_list->size() == headers_list->size());
+  MOZ_ASSERT(start <= end && end <= headers_sort_list->size());
+  if (start == end) {
+    return;
+  }
+
+  // Entries with equal names are sorted in insertion order, so these are ascending.
+  std::vector<size_t> erased;
+  erased.reserve(end - start);
+  for (size_t i = start; i < end; i++) {
+    erased.push_back(headers_sort_list->at(i).index);
+  }
+  MOZ_ASSERT(std::is_sorted(erased.begin(), erased.end()));
 
-    list->emplace_back(host_api::HostString(header_name), host_api::HostString(header_val));
-    // add the new index to the sort list for sorting
-    mark_for_sort(self);
+  // Compact the headers list in a single pass.
+  size_t next_erased = 0;
+  size_t write = 0;
+  for (size_t read = 0; read < headers_list->size(); read++) {
+    if (next_erased < erased.size() && erased[next_erased] == read) {
+      next_erased++;
+      continue;
+    }
+    if (write != read) {
+      headers_list->at(write) = std::move(headers_list->at(read));
+    }
+    write++;
   }
+  headers_list->resize(write);
+
+  // Remove the erased entries from the sort list, and shift the indices of the remaining ones.
+  headers_sort_list->erase(headers_sort_list->begin() + start, headers_sort_list->begin() + end);
+  for (auto &entry : *headers_sort_list) {
+    entry.index -= std::lower_bound(erased.begin(), erased.end(), entry.index) - erased.begin();
+  }
+}
+
+bool append_valid_normalized_header(JSContext *cx, HandleObject self, string_view header_name,
+                                    string_view header_val) {
+  MOZ_ASSERT(Headers::mode(self) == Headers::Mode::ContentOnly);
+
+  Headers::HeadersList *list = Headers::headers_list(self);
+
+  list->emplace_back(host_api::HostString(header_name), host_api::HostString(header_val));
+  insert_last_into_sort_list(self);
 
   return true;
 }
 
+// Returns new, empty storage holding a single reference, which is released in `finalize`.
+Headers::HeadersStorage *new_storage() {
+  auto *storage = js_new<Headers::HeadersStorage>();
+  MOZ_RELEASE_ASSERT(storage);
+  storage->AddRef();
+  return storage;
+}
+
 bool switch_mode(JSContext *cx, HandleObject self, const Headers::Mode mode) {
   auto current_mode = Headers::mode(self);
   if (mode == current_mode) {
@@ -440,15 +470,11 @@ bool switch_mode(JSContext *cx, HandleObject self, const Headers::Mode mode) {
 
   if (current_mode == Headers::Mode::Uninitialized) {
     MOZ_ASSERT(mode == Headers::Mode::ContentOnly);
-    MOZ_ASSERT(JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersList))
-                   .toPrivate() == nullptr);
-    MOZ_ASSERT(JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersSortList))
+    MOZ_ASSERT(JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::Entries))
                    .toPrivate() == nullptr);
 
-    SetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersList),
-                    PrivateValue(js_new<Headers::HeadersList>()));
-    SetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersSortList),
-                    PrivateValue(js_new<std::vector<size_t>>()));
+    SetReservedSlot(self, static_cast<size_t>(Headers::Slots::Entries),
+                    PrivateValue(new_storage()));
     SetReservedSlot(self, static_cast<size_t>(Headers::Slots::Mode),
                     JS::Int32Value(static_cast<int32_t>(Headers::Mode::ContentOnly)));
 
@@ -470,15 +496,11 @@ bool switch_mode(JSContext *cx, HandleObject self, const Headers::Mode mode) {
 
   if (current_mode == Headers::Mode::HostOnly) {
     MOZ_ASSERT(mode == Headers::Mode::CachedInContent);
-    MOZ_ASSERT(JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersList))
-                   .toPrivate() == nullptr);
-    MOZ_ASSERT(JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersSortList))
+    MOZ_ASSERT(JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::Entries))
                    .toPrivate() == nullptr);
 
-    SetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersList),
-                    PrivateValue(js_new<Headers::HeadersList>()));
-    SetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersSortList),
-                    PrivateValue(js_new<std::vector<size_t>>()));
+    SetReservedSlot(self, static_cast<size_t>(Headers::Slots::Entries),
+                    PrivateValue(new_storage()));
     SetReservedSlot(self, static_cast<size_t>(Headers::Slots::Mode),
                     JS::Int32Value(static_cast<int32_t>(Headers::Mode::ContentOnly)));
 
@@ -491,10 +513,7 @@ bool switch_mode(JSContext *cx, HandleObject self, const Headers::Mode mode) {
       return false;
     }
 
-    Headers::HeadersList *list = Headers::headers_list(self);
-    for (auto &entry : std::move(res.unwrap())) {
-      list->emplace_back(std::move(std::get<0>(entry)), std::move(std::get<1>(entry)));
-    }
+    *Headers::headers_list(self) = std::move(res.unwrap());
   }
 
   if (mode == Headers::Mode::ContentOnly) {
@@ -509,23 +528,40 @@ bool switch_mode(JSContext *cx, HandleObject self, const Headers::Mode mode) {
   return true;
 }
 
+// All modifications are applied to the content list. Host-backed headers are pulled into it with
+// a single `entries` call, instead of cloning the handle and making a host call per modification,
+// and a handle is only recreated in bulk, via `fields.from-list`, once one is needed again.
 bool prepare_for_entries_modification(JSContext *cx, JS::HandleObject self) {
   auto mode = Headers::mode(self);
   if (mode == Headers::Mode::HostOnly) {
-    auto *handle = get_handle(self);
-    if (!handle->is_writable()) {
-      auto *new_handle = handle->clone();
-      if (!new_handle) {
-        return api::throw_error(cx, FetchErrors::HeadersCloningFailed);
-      }
-      delete handle;
-      SetReservedSlot(self, static_cast<size_t>(Headers::Slots::Handle), PrivateValue(new_handle));
+    if (!switch_mode(cx, self, Headers::Mode::CachedInContent)) {
+      return false;
     }
-  } else if (mode == Headers::Mode::CachedInContent || mode == Headers::Mode::Uninitialized) {
+    mode = Headers::Mode::CachedInContent;
+  }
+  if (mode == Headers::Mode::CachedInContent || mode == Headers::Mode::Uninitialized) {
     if (!switch_mode(cx, self, Headers::Mode::ContentOnly)) {
       return false;
     }
   }
+
+  // Copy the storage if it's shared with other instances.
+  auto *storage = Headers::headers_storage(self);
+  if (!storage->hasOneRef()) {
+    auto *copy = new_storage();
+    copy->list.reserve(storage->list.size());
+    for (const auto &[name, value] : storage->list) {
+      copy->list.emplace_back(string_view(name), string_view(value));
+    }
+    copy->sort_list = storage->sort_list;
+    storage->Release();
+    SetReservedSlot(self, static_cast<size_t>(Headers::Slots::Entries), PrivateValue(copy));
+  }
+
+  JS::SetReservedSlot(self, static_cast<uint32_t>(Headers::Slots::ValueCache), JS::UndefinedValue());
+  JS::SetReservedSlot(self, static_cast<uint32_t>(Headers::Slots::SetCookieCache),
+                      JS::UndefinedValue());
+
   // bump the generation integer
   uint32_t gen = JS::GetReservedSlot(self, static_cast<uint32_t>(Headers::Slots::Gen)).toInt32();
   if (gen != INT32_MAX) {
@@ -536,18 +572,19 @@ bool prepare_for_entries_modification(JSContext *cx, JS::HandleObject self) {
 
 } // namespace
 
+Headers::HeadersStorage *Headers::headers_storage(JSObject *self) {
+  auto *storage = static_cast<Headers::HeadersStorage *>(
+      JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::Entries)).toPrivate());
+  MOZ_ASSERT(storage);
+  return storage;
+}
+
 Headers::HeadersList *Headers::headers_list(JSObject *self) {
-  auto *list = static_cast<Headers::HeadersList *>(
-      JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersList)).toPrivate());
-  MOZ_ASSERT(list);
-  return list;
+  return &headers_storage(self)->list;
 }
 
 Headers::HeadersSortList *Headers::headers_sort_list(JSObject *self) {
-  auto *list = static_cast<Headers::HeadersSortList *>(
-      JS::GetReservedSlot(self, static_cast<size_t>(Headers::Slots::HeadersSortList)).toPrivate());
-  MOZ_ASSERT(list);
-  return list;
+  return &headers_storage(self)->sort_list;
 }
 
 Headers::Mode Headers::mode(JSObject *self) {
@@ -589,13 +626,9 @@ host_api::HostString Headers::validate_header_name(JSContext *cx, HandleValue na
     return host_api::HostString{};
   }
 
-  char *name_chars = name.begin();
-  for (size_t i = 0; i < name.len; i++) {
-    const unsigned char ch = name_chars[i];
-    if (ch > 127 || (VALID_NAME_CHARS.at(ch) == 0)) {
-      api::throw_error(cx, FetchErrors::InvalidHeaderName, fun_name, name_chars);
-      return host_api::HostString{};
-    }
+  if (!is_valid_header_name(name.begin(), name.len)) {
+    api::throw_error(cx, FetchErrors::InvalidHeaderName, fun_name, name.begin());
+    return host_api::HostString{};
   }
 
   return name;
@@ -612,12 +645,56 @@ JSObject *Headers::create(JSContext *cx, HeadersGuard guard) {
   SetReservedSlot(self, static_cast<uint32_t>(Slots::Mode),
                   JS::Int32Value(static_cast<int32_t>(Mode::Uninitialized)));
 
-  SetReservedSlot(self, static_cast<uint32_t>(Slots::HeadersList), PrivateValue(nullptr));
-  SetReservedSlot(self, static_cast<uint32_t>(Slots::HeadersSortList), PrivateValue(nullptr));
+  SetReservedSlot(self, static_cast<uint32_t>(Slots::Entries), PrivateValue(nullptr));
   SetReservedSlot(self, static_cast<uint32_t>(Slots::Gen), JS::Int32Value(0));
   return self;
 }
 
+bool Headers::share_entries(JSContext *cx, HandleObject self, HandleValue initv, bool *shared) {
+  MOZ_ASSERT(mode(self) == Mode::Uninitialized);
+  *shared = false;
+
+  RootedObject source(cx, &initv.toObject());
+  if (mode(source) == Mode::Uninitialized) {
+    *shared = true;
+    return true;
+  }
+
+  HeadersList *list = get_list(cx, source);
+  if (!list) {
+    return false;
+  }
+  HeadersSortList *sort_list = headers_sort_list(source);
+  ensure_updated_sort_list(list, sort_list);
+
+  // Entries the target's guard would filter out have to go through the regular path. Forbidden
+  // header names are all well-known, so checking the interned ids is enough.
+  auto target_guard = guard(self);
+  if (target_guard != guard(source)) {
+    const ForbiddenHeaders *forbidden = nullptr;
+    if (target_guard == HeadersGuard::Request) {
+      forbidden = &forbidden_request_headers;
+    } else if (target_guard == HeadersGuard::Response) {
+      forbidden = &forbidden_response_headers;
+    }
+    if (forbidden) {
+      for (const auto &entry : *sort_list) {
+        if ((*forbidden)[entry.key.id]) {
+          return true;
+        }
+      }
+    }
+  }
+
+  auto *storage = headers_storage(source);
+  storage->AddRef();
+  SetReservedSlot(self, static_cast<uint32_t>(Slots::Entries), PrivateValue(storage));
+  SetReservedSlot(self, static_cast<uint32_t>(Slots::Mode),
+                  JS::Int32Value(static_cast<int32_t>(Mode::ContentOnly)));
+  *shared = true;
+  return true;
+}
+
 JSObject *Headers::create(JSContext *cx, host_api::HttpHeadersReadOnly *handle,
                           HeadersGuard guard) {
   RootedObject self(cx, create(cx, guard));
@@ -646,8 +723,16 @@ JSObject *Headers::create(JSContext *cx, HandleValue init_headers, HeadersGuard
 }
 
 bool Headers::init_entries(JSContext *cx, HandleObject self, HandleValue initv) {
-  // TODO: check if initv is a Headers instance and clone its handle if so.
-  // TODO: But note: forbidden headers have to be applied correctly.
+  if (initv.isObject() && is_instance(&initv.toObject())) {
+    bool shared = false;
+    if (!share_entries(cx, self, initv, &shared)) {
+      return false;
+    }
+    if (shared) {
+      return true;
+    }
+  }
+
   bool consumed = false;
   if (!core::maybe_consume_sequence_or_record<host_api::HostString, validate_header_name,
                                               append_valid_header, append_valid_header>(cx, initv, self, &consumed,
@@ -681,10 +766,8 @@ bool Headers::get(JSContext *cx, unsigned argc, JS::Value *vp) {
     return true;
   }
 
-  if (mode == Mode::HostOnly) {
-    return retrieve_value_for_header_from_handle(cx, self, name_chars, args.rval());
-  }
-
+  // Looking up a header in host-only mode pulls all entries in one go, so that later lookups don't
+  // need host calls. JS strings are only created for the values that are actually read.
   auto idx = Headers::lookup(cx, self, name_chars);
   if (!idx) {
     args.rval().setNull();
@@ -701,25 +784,29 @@ bool Headers::get(JSContext *cx, unsigned argc, JS::Value *vp) {
 bool Headers::getSetCookie(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER(0)
 
-  JS::RootedObject out_arr(cx, JS::NewArrayObject(cx, 0));
-  args.rval().setObject(*out_arr);
-
-  Mode mode = Headers::mode(self);
-  if (mode == Headers::Mode::Uninitialized) {
-    return true;
-}
-
-  if (mode == Mode::HostOnly) {
-    if (!retrieve_values_for_header_from_handle(cx, self, set_cookie_str, &out_arr)) {
+  JS::RootedValueVector strings(cx);
+  if (Headers::mode(self) != Headers::Mode::Uninitialized) {
+    JS::RootedObject values(cx);
+    if (!set_cookie_values(cx, self, &values)) {
       return false;
-}
-  } else {
-    auto idx = Headers::lookup(cx, self, set_cookie_str);
-    if (idx && !retrieve_values_for_header_from_list(cx, self, idx.value(), &out_arr)) {
+    }
+    // The cached array itself mustn't be handed out, since content could modify it.
+    uint32_t len = 0;
+    if (!JS::GetArrayLength(cx, values, &len) || !strings.resize(len)) {
       return false;
-}
+    }
+    for (uint32_t i = 0; i < len; i++) {
+      if (!JS_GetElement(cx, values, i, strings[i])) {
+        return false;
+      }
+    }
   }
 
+  JS::RootedObject out_arr(cx, JS::NewArrayObject(cx, strings));
+  if (!out_arr) {
+    return false;
+  }
+  args.rval().setObject(*out_arr);
   return true;
 }
 
@@ -732,7 +819,7 @@ bool Headers::set(JSContext *cx, unsigned argc, JS::Value *vp) {
   }
 
   auto value_chars = normalize_and_validate_header_value(cx, args[1], "headers.set");
-  if (!value_chars.ptr) {
+  if (!value_chars) {
     return false;
   }
 
@@ -750,69 +837,28 @@ bool Headers::set(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  Mode mode = Headers::mode(self);
-  if (mode == Mode::HostOnly) {
-    auto *handle = get_handle(self)->as_writable();
-    MOZ_ASSERT(handle);
-    auto res = handle->set(name_chars, value_chars);
-    if (const auto *err = res.to_err()) {
-      HANDLE_ERROR(cx, *err);
-      return false;
-    }
-  } else {
-    MOZ_ASSERT(mode == Mode::ContentOnly);
-
-    auto idx = Headers::lookup(cx, self, name_chars);
-    if (!idx) {
-      args.rval().setUndefined();
-      return append_valid_normalized_header(cx, self, std::move(name_chars), std::move(value_chars));
-    }
-
-    size_t index = idx.value();
-    // The lookup above will guarantee that sort_list is up to date.
-    std::vector<size_t> *headers_sort_list = Headers::headers_sort_list(self);
-    HeadersList *headers_list = Headers::headers_list(self);
-
-    // Update the first entry in place to the new value
-    host_api::HostString *header_val =
-        &std::get<1>(headers_list->at(headers_sort_list->at(index)));
-
-    // Swap in the new value respecting the disposal semantics
-    header_val->ptr.swap(value_chars.ptr);
-    header_val->len = value_chars.len;
+  MOZ_ASSERT(Headers::mode(self) == Mode::ContentOnly);
 
-    // Delete all subsequent entries for this header excluding the first,
-    // as a variation of Headers::delete.
-    size_t len = headers_list->size();
-    size_t delete_cnt = 0;
-
-    while (true) {
-      size_t next_index = index + delete_cnt + 1;
-      if (next_index >= len) {
-        break;
-      }
-
-      size_t sorted_pos = headers_sort_list->at(next_index);
-      if (sorted_pos < delete_cnt) {
-        break;
-      }
+  auto idx = Headers::lookup(cx, self, name_chars);
+  if (!idx) {
+    args.rval().setUndefined();
+    return append_valid_normalized_header(cx, self, std::move(name_chars), std::move(value_chars));
+  }
 
-      size_t actual_pos = sorted_pos - delete_cnt;
-      const auto& header_name = std::get<0>(headers_list->at(actual_pos));
+  size_t index = idx.value();
+  // The lookup above will guarantee that sort_list is up to date.
+  Headers::HeadersSortList *headers_sort_list = Headers::headers_sort_list(self);
+  HeadersList *headers_list = Headers::headers_list(self);
 
-      if (header_compare(header_name, name_chars) != Ordering::Equal) {
-        break;
-      }
+  // Update the first entry in place to the new value
+  host_api::HostString *header_val =
+      &std::get<1>(headers_list->at(headers_sort_list->at(index).index));
 
-      headers_list->erase(headers_list->begin() + actual_pos);
-      delete_cnt++;
-    }
+  *header_val = std::move(value_chars);
 
-    // Reset the sort list if we performed additional deletions.
-    if (delete_cnt > 0) {
-      headers_sort_list->clear();
-    }
-  }
+  // Delete all subsequent entries for this header excluding the first,
+  // as a variation of Headers::delete.
+  erase_sorted_range(self, index + 1, end_of_name_range(headers_list, headers_sort_list, index));
 
   args.rval().setUndefined();
   return true;
@@ -832,15 +878,7 @@ bool Headers::has(JSContext *cx, unsigned argc, JS::Value *vp) {
     return true;
   }
 
-  if (mode == Mode::HostOnly) {
-    auto *handle = get_handle(self);
-    MOZ_ASSERT(handle);
-    auto res = handle->has(name_chars);
-    MOZ_ASSERT(!res.is_err());
-    args.rval().setBoolean(res.unwrap());
-  } else {
-    args.rval().setBoolean(Headers::lookup(cx, self, name_chars).has_value());
-  }
+  args.rval().setBoolean(Headers::lookup(cx, self, name_chars).has_value());
 
   return true;
 }
@@ -890,12 +928,15 @@ bool Headers::append(JSContext *cx, unsigned argc, JS::Value *vp) {
   skip_values_for_header_from_list(cx, self, &index, false);
   host_api::HostString *header_val = &std::get<1>(*Headers::get_index(cx, self, index));
   size_t combined_len = header_val->len + value_chars.len + 2;
-  auto combined = JS::UniqueChars(static_cast<char *>(js_malloc(combined_len)));
-  memcpy(combined.get(), header_val->ptr.get(), header_val->len);
-  memcpy(combined.get() + header_val->len, ", ", 2);
-  memcpy(combined.get() + header_val->len + 2, value_chars.ptr.get(), value_chars.len);
-  header_val->ptr.swap(combined);
-  header_val->len = combined_len;
+  auto combined = host_api::HostString::with_length(combined_len);
+  if (!combined) {
+    JS_ReportOutOfMemory(cx);
+    return false;
+  }
+  memcpy(combined.data(), header_val->data(), header_val->len);
+  memcpy(combined.data() + header_val->len, ", ", 2);
+  memcpy(combined.data() + header_val->len + 2, value_chars.data(), value_chars.len);
+  *header_val = std::move(combined);
 
   args.rval().setUndefined();
   return true;
@@ -908,22 +949,6 @@ bool Headers::set_valid_if_undefined(JSContext *cx, HandleObject self, string_vi
     return false;
 }
 
-  if (mode(self) == Mode::HostOnly) {
-    auto *handle = get_handle(self)->as_writable();
-    auto has = handle->has(name);
-    MOZ_ASSERT(!has.is_err());
-    if (has.unwrap()) {
-      return true;
-    }
-
-    auto res = handle->append(name, value);
-    if (const auto *err = res.to_err()) {
-      HANDLE_ERROR(cx, *err);
-      return false;
-    }
-    return true;
-  }
-
   MOZ_ASSERT(mode(self) == Mode::ContentOnly);
   if (Headers::lookup(cx, self, name)) {
     return true;
@@ -954,21 +979,7 @@ bool Headers::delete_(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  Mode mode = Headers::mode(self);
-  if (mode == Mode::HostOnly) {
-    auto *handle = get_handle(self)->as_writable();
-    MOZ_ASSERT(handle);
-    std::string_view name = name_chars;
-    auto res = handle->remove(name);
-    if (const auto *err = res.to_err()) {
-      HANDLE_ERROR(cx, *err);
-      return false;
-    }
-    args.rval().setUndefined();
-    return true;
-  }
-
-  MOZ_ASSERT(mode == Mode::ContentOnly);
+  MOZ_ASSERT(Headers::mode(self) == Mode::ContentOnly);
 
   auto idx = Headers::lookup(cx, self, name_chars);
   if (!idx) {
@@ -978,40 +989,11 @@ bool Headers::delete_(JSContext *cx, unsigned argc, JS::Value *vp) {
 
   size_t index = idx.value();
   // The lookup above will guarantee that sort_list is up to date.
-  std::vector<size_t> *headers_sort_list = Headers::headers_sort_list(self);
+  Headers::HeadersSortList *headers_sort_list = Headers::headers_sort_list(self);
   HeadersList *headers_list = Headers::headers_list(self);
 
-  // Delete all case-insensitively equal names.
-  // The ordering guarantee for sort_list is that equal names will come later in headers_list
-  // so that we can continue to use sort list during the delete operation, only recomputing it
-  // after.
-  size_t delete_cnt = 0;
-  size_t len = headers_sort_list->size();
-
-  while (true) {
-    size_t current_index = index + delete_cnt;
-
-    if (current_index >= len) {
-      break;
-    }
-
-    size_t sorted_pos = headers_sort_list->at(current_index);
-    if (sorted_pos < delete_cnt) {
-      break;
-    }
-
-    size_t actual_pos = sorted_pos - delete_cnt;
-    const auto& header_name = std::get<0>(headers_list->at(actual_pos));
-
-    if (header_compare(header_name, name_chars) != Ordering::Equal) {
-      break;
-    }
-
-    headers_list->erase(headers_list->begin() + actual_pos);
-    delete_cnt++;
-  }
-
-  headers_sort_list->clear();
+  // Delete all case-insensitively equal names, which are adjacent in the sort list.
+  erase_sorted_range(self, index, end_of_name_range(headers_list, headers_sort_list, index));
 
   args.rval().setUndefined();
   return true;
@@ -1030,7 +1012,7 @@ bool Headers::append_valid_header(JSContext *cx, JS::HandleObject self,
   }
 
   auto value_chars = normalize_and_validate_header_value(cx, value, fun_name);
-  if (!value_chars.ptr) {
+  if (!value_chars) {
     return false;
   }
 
@@ -1085,8 +1067,7 @@ bool Headers::constructor(JSContext *cx, unsigned argc, JS::Value *vp) {
   }
   SetReservedSlot(self, static_cast<uint32_t>(Slots::Guard),
                   JS::Int32Value(static_cast<int32_t>(HeadersGuard::None)));
-  SetReservedSlot(self, static_cast<uint32_t>(Slots::HeadersList), PrivateValue(nullptr));
-  SetReservedSlot(self, static_cast<uint32_t>(Slots::HeadersSortList), PrivateValue(nullptr));
+  SetReservedSlot(self, static_cast<uint32_t>(Slots::Entries), PrivateValue(nullptr));
   SetReservedSlot(self, static_cast<uint32_t>(Slots::Gen), JS::Int32Value(0));
 
   // walk the headers list writing in the ordered normalized case headers (distinct from the wire)
@@ -1099,32 +1080,25 @@ bool Headers::constructor(JSContext *cx, unsigned argc, JS::Value *vp) {
 }
 
 void Headers::finalize(JS::GCContext *gcx, JSObject *self) {
-  auto *list = static_cast<HeadersList *>(
-      JS::GetReservedSlot(self, static_cast<size_t>(Slots::HeadersList)).toPrivate());
-  if (list != nullptr) {
-    list->clear();
-    js_delete(list);
-  }
-  auto *sort_list = static_cast<HeadersSortList *>(
-      JS::GetReservedSlot(self, static_cast<size_t>(Slots::HeadersSortList)).toPrivate());
-  if (sort_list != nullptr) {
-    sort_list->clear();
-    js_delete(sort_list);
+  auto *storage = static_cast<HeadersStorage *>(
+      JS::GetReservedSlot(self, static_cast<size_t>(Slots::Entries)).toPrivate());
+  if (storage != nullptr) {
+    storage->Release();
   }
 }
 
 bool Headers::init_class(JSContext *cx, JS::HandleObject global) {
-  // get the host forbidden headers for guard checks
-  forbidden_request_headers = &host_api::HttpHeaders::get_forbidden_request_headers();
-  forbidden_response_headers = &host_api::HttpHeaders::get_forbidden_response_headers();
-
-  // sort the forbidden headers with the lowercase-invariant comparator
-  MOZ_RELEASE_ASSERT(std::is_sorted(forbidden_request_headers->begin(),
-                                    forbidden_request_headers->end(), HeaderCompare()),
-                     "Forbidden request headers must be sorted");
-  MOZ_RELEASE_ASSERT(std::is_sorted(forbidden_response_headers->begin(),
-                                    forbidden_response_headers->end(), HeaderCompare()),
-                     "Forbidden response headers must be sorted");
+  // get the host forbidden headers for guard checks, which are all well-known header names.
+  for (const auto *name : host_api::HttpHeaders::get_forbidden_request_headers()) {
+    auto id = well_known_header_id(name);
+    MOZ_RELEASE_ASSERT(id != 0, "Forbidden request headers must be well-known header names");
+    forbidden_request_headers[id] = true;
+  }
+  for (const auto *name : host_api::HttpHeaders::get_forbidden_response_headers()) {
+    auto id = well_known_header_id(name);
+    MOZ_RELEASE_ASSERT(id != 0, "Forbidden response headers must be well-known header names");
+    forbidden_response_headers[id] = true;
+  }
 
   if (!init_class_impl(cx, global)) {
     return false;
@@ -1171,10 +1145,15 @@ unique_ptr<host_api::HttpHeaders> Headers::handle_clone(JSContext *cx, HandleObj
     return std::make_unique<host_api::HttpHeaders>();
   }
 
-  if (mode == Mode::ContentOnly && !switch_mode(cx, self, Mode::CachedInContent)) {
-    // Switch to Mode::CachedInContent to ensure that the latest data is available on the handle,
-    // but without discarding the existing entries, in case content reads them later.
-    return nullptr;
+  // Content-only headers are transferred in bulk, with a single `fields.from-list` call. There's
+  // no need to keep that handle around: any modification content makes later would discard it.
+  if (mode == Mode::ContentOnly) {
+    auto res = host_api::HttpHeaders::FromEntries(*headers_list(self));
+    if (res.is_err()) {
+      api::throw_error(cx, FetchErrors::HeadersCloningFailed);
+      return nullptr;
+    }
+    return unique_ptr<host_api::HttpHeaders>(res.unwrap());
   }
 
   auto handle = unique_ptr<host_api::HttpHeaders>(get_handle(self)->clone());
@@ -1237,27 +1216,28 @@ bool HeadersIterator::init_class(JSContext *cx, JS::HandleObject global) {
 std::tuple<host_api::HostString, host_api::HostString> *
 Headers::get_index(JSContext *cx, JS::HandleObject self, size_t index) {
   MOZ_ASSERT(is_instance(self));
-  std::vector<size_t> *headers_sort_list = Headers::headers_sort_list(self);
+  Headers::HeadersSortList *headers_sort_list = Headers::headers_sort_list(self);
   HeadersList *headers_list = Headers::get_list(cx, self);
 
   ensure_updated_sort_list(headers_list, headers_sort_list);
   MOZ_RELEASE_ASSERT(index < headers_sort_list->size());
 
-  return &headers_list->at(headers_sort_list->at(index));
+  return &headers_list->at(headers_sort_list->at(index).index);
 }
 
 std::optional<size_t> Headers::lookup(JSContext *cx, HandleObject self, string_view key) {
   MOZ_ASSERT(is_instance(self));
   const HeadersList *headers_list = Headers::get_list(cx, self);
-  std::vector<size_t> *headers_sort_list = Headers::headers_sort_list(self);
+  Headers::HeadersSortList *headers_sort_list = Headers::headers_sort_list(self);
 
   ensure_updated_sort_list(headers_list, headers_sort_list);
 
   // Now we know its sorted, we can binary search.
+  auto name_key = HeaderNameKey::from(key);
   auto it = std::lower_bound(headers_sort_list->begin(), headers_sort_list->end(), key,
-                             HeadersSortListLookupCompare(headers_list));
+                             HeadersSortListLookupCompare(headers_list, name_key));
   if (it == headers_sort_list->end() ||
-      header_compare(std::get<0>(headers_list->at(*it)), key) != Ordering::Equal) {
+      !header_equals(it->key, std::get<0>(headers_list->at(it->index)), name_key, key)) {
     return std::nullopt;
   }
   return it - headers_sort_list->begin();
@@ -1296,9 +1276,9 @@ bool HeadersIterator::next(JSContext *cx, unsigned argc, Value *vp) {
     size_t len = key->len;
     auto chars = JS::UniqueLatin1Chars(static_cast<JS::Latin1Char *>(js_malloc(len)));
     for (int i = 0; i < len; ++i) {
-      const unsigned char ch = key->ptr[i];
+      const unsigned char ch = key->data()[i];
       // headers should already be validated by here
-      MOZ_ASSERT(ch <= 127 && VALID_NAME_CHARS.at(ch));
+      MOZ_ASSERT(is_header_name_char(ch));
       // we store header keys with casing, so getter itself lowercases
       if (ch >= 'A' && ch <= 'Z') {
         chars[i] = ch - 'A' + 'a';
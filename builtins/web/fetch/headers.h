@@ -2,6 +2,7 @@
 #define BUILTINS_WEB_FETCH_HEADERS_H
 
 #include "builtin.h"
+#include "header-names.h"
 #include "host_api.h"
 
 
@@ -38,21 +39,25 @@ public:
   /// The mode of Headers instances created via the `headers` accessor on `Request` and `Response`
   /// instances is determined by how those instances themselves were created:
   /// - If a `Request` or `Response` instance represents an incoming request or response, the mode
-  ///   will initially be `HostOnly`.
+  ///   will initially be `CachedInContent`: all entries are retrieved with a single host call
+  ///   once content accesses the `headers` property, since lookups would otherwise each take one.
   /// - If a `Request` or `Response` instance represents an outgoing request or response, the mode
   ///   of the `Headers` instance depends on the `HeadersInit` argument passed to the `Request` or
   ///   `Response` constructor (see above).
   ///
   /// A `Headers` instance can transition from `HostOnly` to `CachedInContent` or `ContentOnly`
   /// mode:
-  /// Iterating over headers (as keys, values, or entries) would be extremely slow if we retrieved
-  /// all of them from the host for each iteration step.
-  /// Instead, when iterating over the headers of a `HostOnly` mode `Headers` instance, the instance
-  /// is transitioned to `CachedInContent` mode, and the entries are stored in a Map in the
-  /// `Entries` slot.
+  /// Looking up or iterating over headers would be extremely slow if we retrieved them from the
+  /// host for each lookup or iteration step.
+  /// Instead, the first time content reads from a `HostOnly` mode `Headers` instance, the instance
+  /// is transitioned to `CachedInContent` mode, and the entries are stored as byte strings in the
+  /// `Entries` slot. JS strings are only created for the values content actually reads, and are
+  /// cached in the `ValueCache` slot until the next modification.
   ///
-  /// If a header is added, deleted, or replaced on an instance in `CachedInContent` mode, the
-  /// instance transitions to `ContentOnly` mode, and the underlying resource handle is discarded.
+  /// If a header is added, deleted, or replaced on an instance in `HostOnly` or `CachedInContent`
+  /// mode, the instance transitions to `ContentOnly` mode, and the underlying resource handle is
+  /// discarded. When a handle is needed again, e.g. to send the headers, it's created from the
+  /// entire list at once.
   enum class Mode : uint8_t {
     HostOnly,        // Headers are stored in the host.
     CachedInContent, // Host holds canonical headers, content a cached copy.
@@ -66,17 +71,36 @@ public:
   // A sort list is maintained of ordered indicies of the the sorted lowercase keys of main headers
   // list, with each index of HeadersList always being present in this list once and only once.
   // All lookups are done as indices in this list, which then map to indices in HeadersList.
-  // When this list is empty, that means the sort list is not valid and needs to be computed. For
-  // example, it is cleared after an insertion. It is recomputed lazily for every lookup.
-  using HeadersSortList = std::vector<size_t>;
+  // The list is computed lazily, by the first lookup after the headers list is created. From then
+  // on, it's kept up to date incrementally: an appended header is inserted after all entries with
+  // the same name using a binary search, and deleting a name's entries compacts both lists in a
+  // single pass, shifting the remaining indices down. An empty list means it hasn't been computed.
+  // Each entry also holds the key of its header name, so that lookups and sorting mostly compare
+  // integers instead of names.
+  struct HeadersSortEntry {
+    size_t index;
+    HeaderNameKey key;
+  };
+  using HeadersSortList = std::vector<HeadersSortEntry>;
+
+  // The list and sort list of a Headers instance. Instances created from one another, e.g. by
+  // `Request#clone` or `new Headers(headers)`, share their storage until one of them is modified,
+  // at which point that instance gets its own copy.
+  struct HeadersStorage : public js::RefCounted<HeadersStorage> {
+    HeadersList list;
+    HeadersSortList sort_list;
+  };
 
   enum class Slots : uint8_t {
     Handle,
-    HeadersList,
-    HeadersSortList,
+    Entries,
     Mode,
     Guard,
     Gen,
+    // Array of the JS strings created for header values, indexed by their sort list index.
+    ValueCache,
+    // Array of the JS strings created for `set-cookie` values, which are never combined.
+    SetCookieCache,
     Count,
   };
 
@@ -87,6 +111,7 @@ public:
     Immutable,
   };
 
+  static HeadersStorage *headers_storage(JSObject *self);
   static HeadersList *headers_list(JSObject *self);
   static HeadersSortList *headers_sort_list(JSObject *self);
   static Mode mode(JSObject *self);
@@ -132,6 +157,10 @@ public:
 
   static bool init_entries(JSContext *cx, HandleObject self, HandleValue initv);
 
+  /// Makes `self` share the entries of the Headers instance `initv`, if all of them are valid for
+  /// `self`'s guard. Sets `shared` to false if the entries have to be appended one by one instead.
+  static bool share_entries(JSContext *cx, HandleObject self, HandleValue initv, bool *shared);
+
   /// Returns the headers list of entries, constructing it if necessary.
   /// Depending on the `Mode` the instance is in, this can be a cache or the canonical store for
   /// the headers.
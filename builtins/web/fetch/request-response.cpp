@@ -23,9 +23,13 @@
 #include "js/Stream.h"
 #include "js/experimental/TypedData.h"
 #include "mozilla/ResultVariant.h"
+#include "rust-encoding.h"
 
 #include "../worker-location.h"
 
+#include <algorithm>
+#include <charconv>
+
 namespace builtins::web::streams {
 
 bool NativeStreamSource::stream_is_body(JSContext *cx, JS::HandleObject stream) {
@@ -60,8 +64,18 @@ bool error_stream_controller_with_pending_exception(JSContext *cx, HandleObject
   return JS::ReadableStreamError(cx, stream, args);
 }
 
-constexpr size_t HANDLE_READ_CHUNK_SIZE = 8192;
+constexpr uint32_t HANDLE_READ_CHUNK_SIZE = 8192;
 
+/**
+ * Reads the next chunk of an incoming body once data is available, and enqueues it into the
+ * body's ReadableStream.
+ *
+ * Each wakeup drains everything that's immediately available, up to the body's current read chunk
+ * size, and enqueues it as a single chunk. The stream only pulls while its desiredSize is positive,
+ * so this preserves backpressure. The read chunk size starts at `HANDLE_READ_CHUNK_SIZE`, and
+ * doubles up to the configured maximum whenever a wakeup fills it completely. It's halved again
+ * whenever less than half of it was filled.
+ */
 class BodyFutureTask final : public api::AsyncTask {
   Heap<JSObject *> body_source_;
   host_api::HttpIncomingBody *incoming_body_;
@@ -82,22 +96,71 @@ public:
     RootedObject stream(cx, streams::NativeStreamSource::stream(body_source_));
     auto *body = RequestOrResponse::incoming_body_handle(owner);
 
-    auto read_res = body->read(HANDLE_READ_CHUNK_SIZE);
-    if (read_res.to_err()) {
-      const auto *receiver = Request::is_instance(owner) ? "request" : "response";
-      api::throw_error(cx, FetchErrors::IncomingBodyStreamError, receiver);
-      return error_stream_controller_with_pending_exception(cx, stream);
+    uint32_t max_chunk_size = std::max(engine->max_body_read_chunk_size(), HANDLE_READ_CHUNK_SIZE);
+    uint32_t chunk_size = std::clamp(body->read_chunk_size, HANDLE_READ_CHUNK_SIZE, max_chunk_size);
+
+    // Read until either the chunk size is reached or the host has no more data available. A read
+    // that returns less than requested means that all available data was read.
+    std::vector<host_api::HostBytes> reads;
+    size_t total = 0;
+    bool done = false;
+    while (total < chunk_size) {
+      uint32_t requested = chunk_size - total;
+      auto read_res = body->read(requested);
+      if (read_res.to_err()) {
+        const auto *receiver = Request::is_instance(owner) ? "request" : "response";
+        api::throw_error(cx, FetchErrors::IncomingBodyStreamError, receiver);
+        return error_stream_controller_with_pending_exception(cx, stream);
+      }
+
+      auto &chunk = read_res.unwrap();
+      if (chunk.done) {
+        done = true;
+        break;
+      }
+      size_t len = chunk.bytes.len;
+      if (len == 0) {
+        break;
+      }
+      total += len;
+      reads.push_back(std::move(chunk.bytes));
+      if (len < requested) {
+        break;
+      }
+    }
+
+    if (total == chunk_size) {
+      body->read_chunk_size = std::min(chunk_size * 2, max_chunk_size);
+    } else if (total < chunk_size / 2) {
+      body->read_chunk_size = std::max(chunk_size / 2, HANDLE_READ_CHUNK_SIZE);
     }
 
-    auto &chunk = read_res.unwrap();
-    if (chunk.done) {
-      return JS::ReadableStreamClose(cx, stream);
+    if (reads.empty()) {
+      if (done) {
+        return JS::ReadableStreamClose(cx, stream);
+      }
+      // Nothing is available yet, so wait for the next wakeup.
+      engine->queue_async_task(this);
+      return true;
+    }
+
+    // Only concatenate if the data arrived in multiple reads: otherwise, the read buffer can be
+    // handed to the ArrayBuffer as-is.
+    host_api::HostBytes bytes;
+    if (reads.size() == 1) {
+      bytes = std::move(reads[0]);
+    } else {
+      bytes = host_api::HostBytes::with_capacity(total);
+      size_t offset = 0;
+      for (auto &read : reads) {
+        memcpy(bytes.ptr.get() + offset, read.ptr.get(), read.len);
+        offset += read.len;
+      }
     }
 
     // We don't release control of chunk's data until after we've checked that
     // the array buffer allocation has been successful, as that ensures that the
     // return path frees chunk automatically when necessary.
-    auto &bytes = chunk.bytes;
     RootedObject buffer(
         cx, JS::NewArrayBufferWithContents(cx, bytes.len, bytes.ptr.get(),
                                            JS::NewArrayBufferOutOfMemory::CallerMustFreeMemory));
@@ -119,6 +182,8 @@ public:
       return error_stream_controller_with_pending_exception(cx, stream);
     }
 
+    // If the end of the body was reached while reading, the next pull's read will report it again,
+    // and close the stream.
     return cancel(engine);
   }
 
@@ -128,9 +193,417 @@ public:
     return true;
   }
 
+  [[nodiscard]] const char *name() const override { return "BodyFutureTask"; }
+
   void trace(JSTracer *trc) override { TraceEdge(trc, &body_source_, "body source for future"); }
 };
 
+// Incoming bodies that announce a Content-Length up to this size are read into a buffer allocated
+// upfront. Larger ones start out with a smaller buffer, in case the header isn't truthful.
+constexpr size_t MAX_BODY_PRESIZE = 16 * 1024 * 1024;
+
+/**
+ * Reads an incoming body in full, and passes the result to a body parser, as used by `text()`,
+ * `json()`, and the other body mixin methods.
+ *
+ * Unlike consuming the body's ReadableStream, this doesn't create any stream objects, promises, or
+ * per-chunk typed arrays: all data is read straight into a single growable buffer.
+ *
+ * For `text()` and `json()`, the body is decoded from UTF-8 while it's being read, so the buffer
+ * holds UTF-16 code units and the raw bytes are never buffered in full.
+ */
+class BodyDrainTask final : public api::AsyncTask {
+  struct DecoderDeleter {
+    void operator()(jsencoding::Decoder *decoder) { jsencoding::decoder_free(decoder); }
+  };
+
+  Heap<JSObject *> owner_;
+  host_api::HttpIncomingBody *incoming_body_;
+  RequestOrResponse::ParseBodyCB *parse_body_ = nullptr;
+  RequestOrResponse::ParseTextBodyCB *parse_text_body_ = nullptr;
+  std::unique_ptr<jsencoding::Decoder, DecoderDeleter> decoder_;
+
+  // All sizes are in bytes, even if the buffer holds UTF-16 code units.
+  JS::UniqueChars buf_;
+  size_t len_ = 0;
+  size_t capacity_ = 0;
+
+  bool resize(JSContext *cx, size_t capacity) {
+    auto *buf = static_cast<char *>(JS_realloc(cx, buf_.get(), capacity_, capacity));
+    if (!buf) {
+      JS_ReportOutOfMemory(cx);
+      return false;
+    }
+    std::ignore = buf_.release();
+    buf_.reset(buf);
+    capacity_ = capacity;
+    return true;
+  }
+
+  bool reserve(JSContext *cx, size_t additional) {
+    if (len_ + additional <= capacity_) {
+      return true;
+    }
+    return resize(cx, std::max(capacity_ * 2, len_ + additional));
+  }
+
+  /**
+   * Decode `src` into the buffer. Incomplete UTF-8 sequences at the end of `src` are kept in the
+   * decoder until the next call, or replaced with U+FFFD if `last` is true.
+   */
+  bool decode(JSContext *cx, const uint8_t *src, size_t src_len, bool last) {
+    size_t max_units = jsencoding::decoder_max_utf16_buffer_length(decoder_.get(), src_len);
+    if (!reserve(cx, max_units * sizeof(char16_t))) {
+      return false;
+    }
+    auto *dst = reinterpret_cast<uint16_t *>(buf_.get() + len_);
+    bool had_replacements = false;
+    auto result = jsencoding::decoder_decode_to_utf16(decoder_.get(), src, &src_len, dst,
+                                                      &max_units, last, &had_replacements);
+    MOZ_ASSERT(result == 0, "The output buffer is always large enough");
+    std::ignore = result;
+    len_ += max_units * sizeof(char16_t);
+    return true;
+  }
+
+  bool append(JSContext *cx, const uint8_t *src, size_t src_len) {
+    if (decoder_) {
+      return decode(cx, src, src_len, false);
+    }
+    if (!reserve(cx, src_len)) {
+      return false;
+    }
+    memcpy(buf_.get() + len_, src, src_len);
+    len_ += src_len;
+    return true;
+  }
+
+  bool reject_with_pending_error(JSContext *cx, HandleObject owner) {
+    RootedObject result_promise(cx, RequestOrResponse::take_body_all_promise(owner));
+    return RejectPromiseWithPendingError(cx, result_promise);
+  }
+
+  void subscribe() {
+    incoming_body_ = RequestOrResponse::incoming_body_handle(owner_);
+    auto res = incoming_body_->subscribe();
+    MOZ_ASSERT(!res.is_err(), "Subscribing to a future should never fail");
+    handle_ = res.unwrap();
+  }
+
+public:
+  explicit BodyDrainTask(const HandleObject owner, RequestOrResponse::ParseBodyCB *parse_body)
+      : owner_(owner), parse_body_(parse_body) {
+    subscribe();
+  }
+
+  explicit BodyDrainTask(const HandleObject owner,
+                         RequestOrResponse::ParseTextBodyCB *parse_text_body)
+      : owner_(owner), parse_text_body_(parse_text_body) {
+    const char *utf8_label = "UTF-8";
+    const auto *encoding = jsencoding::encoding_for_label_no_replacement(
+        reinterpret_cast<const uint8_t *>(utf8_label), 5);
+    decoder_.reset(jsencoding::encoding_new_decoder_with_bom_removal(encoding));
+    MOZ_ASSERT(decoder_);
+    subscribe();
+  }
+
+  /**
+   * Allocate the buffer for the body upfront, based on its Content-Length header.
+   */
+  bool presize(JSContext *cx) {
+    auto *headers = RequestOrResponse::maybe_headers_handle(owner_);
+    if (!headers) {
+      return true;
+    }
+    auto res = headers->get("content-length");
+    if (res.is_err() || !res.unwrap().has_value() || res.unwrap()->size() != 1) {
+      return true;
+    }
+    auto &value = res.unwrap()->front();
+    size_t length = 0;
+    auto [_, ec] = std::from_chars(value.begin(), value.end(), length);
+    if (ec != std::errc() || length == 0) {
+      return true;
+    }
+    length = std::min(length, MAX_BODY_PRESIZE);
+    if (decoder_) {
+      // UTF-8 never decodes to more UTF-16 code units than it has bytes.
+      length = jsencoding::decoder_max_utf16_buffer_length(decoder_.get(), length) *
+               sizeof(char16_t);
+    }
+    return resize(cx, length);
+  }
+
+  [[nodiscard]] bool run(api::Engine *engine) override {
+    JSContext *cx = engine->cx();
+    RootedObject owner(cx, owner_);
+
+    while (true) {
+      // Reading into a separate buffer is unavoidable, since the host allocates it. That means
+      // there's no need to grow the buffer before knowing whether there's more data.
+      size_t read_size = std::max((capacity_ - len_) / (decoder_ ? sizeof(char16_t) : 1),
+                                  static_cast<size_t>(HANDLE_READ_CHUNK_SIZE));
+      auto read_res = incoming_body_->read(read_size);
+      if (read_res.to_err()) {
+        const auto *receiver = Request::is_instance(owner) ? "request" : "response";
+        api::throw_error(cx, FetchErrors::IncomingBodyStreamError, receiver);
+        return reject_with_pending_error(cx, owner);
+      }
+
+      auto &chunk = read_res.unwrap();
+      if (chunk.done) {
+        break;
+      }
+      if (chunk.bytes.len == 0) {
+        // Wait for more data to arrive.
+        engine->queue_async_task(this);
+        return true;
+      }
+      if (!append(cx, chunk.bytes.ptr.get(), chunk.bytes.len)) {
+        return reject_with_pending_error(cx, owner);
+      }
+    }
+
+    // `src` must not be null, even if it's empty.
+    if (decoder_ && !decode(cx, reinterpret_cast<const uint8_t *>(0x1), 0, true)) {
+      return reject_with_pending_error(cx, owner);
+    }
+
+    // Don't keep unused capacity alive for as long as the result, e.g. an ArrayBuffer, lives.
+    if (len_ < capacity_ && len_ > 0 && !resize(cx, len_)) {
+      return reject_with_pending_error(cx, owner);
+    }
+
+    handle_ = -1;
+    if (decoder_) {
+      JS::UniqueTwoByteChars chars(reinterpret_cast<char16_t *>(buf_.release()));
+      return parse_text_body_(cx, owner, std::move(chars), len_ / sizeof(char16_t));
+    }
+    return parse_body_(cx, owner, std::move(buf_), len_);
+  }
+
+  [[nodiscard]] bool cancel(api::Engine *engine) override {
+    handle_ = -1;
+    return true;
+  }
+
+  [[nodiscard]] const char *name() const override { return "BodyDrainTask"; }
+
+  void trace(JSTracer *trc) override { TraceEdge(trc, &owner_, "body owner for drain task"); }
+};
+
+/**
+ * Returns the TransformStream the readable end of |transform_stream| is piped to, if any.
+ */
+static JSObject *readable_piped_to(JSContext *cx, HandleObject transform_stream) {
+  RootedObject readable(cx, streams::TransformStream::readable(transform_stream));
+  if (!readable) {
+    return nullptr;
+  }
+  JSObject *source = streams::NativeStreamSource::get_stream_source(cx, readable);
+  return streams::NativeStreamSource::piped_to_transform_stream(source);
+}
+
+/**
+ * Pipes an incoming body through a chain of TransformStreams, at least one of which has a native
+ * transform such as the one used by `CompressionStream`, into an outgoing body.
+ *
+ * This is the equivalent of `HttpOutgoingBody::append` for transforming pipes: all chunks are read,
+ * transformed, and written natively, without creating a JS chunk or running a promise reaction for
+ * any of them. Once the incoming body has been consumed and all output has been written, the
+ * completion callback is invoked, which closes the source stream as for a plain append.
+ */
+class BodyTransformTask final : public api::AsyncTask {
+  enum class State : uint8_t {
+    BlockedOnIncoming,
+    BlockedOnOutgoing,
+    Done,
+  };
+
+  struct Stage {
+    Stage(JSObject *transformer, streams::TransformStream::NativeTransformAlgorithmImpl transform)
+        : transformer(transformer), transform(transform) {}
+
+    Heap<JSObject *> transformer;
+    streams::TransformStream::NativeTransformAlgorithmImpl transform;
+  };
+
+  // The first stream of the chain, which is errored if transforming fails.
+  Heap<JSObject *> transform_stream_;
+  std::vector<Stage> stages_;
+  // The output of each stage but the last, which is passed on to the next stage.
+  std::vector<std::vector<uint8_t>> stage_output_;
+  const char *source_kind_;
+  const char *dest_kind_;
+  host_api::HttpIncomingBody *incoming_body_;
+  host_api::HttpOutgoingBody *outgoing_body_;
+  PollableHandle incoming_pollable_;
+  PollableHandle outgoing_pollable_;
+
+  // Transformed data that hasn't been written to the outgoing body yet.
+  std::vector<uint8_t> pending_;
+  size_t written_ = 0;
+  bool input_done_ = false;
+
+  api::TaskCompletionCallback cb_;
+  Heap<JSObject *> cb_receiver_;
+  State state_ = State::BlockedOnIncoming;
+
+  // Writes as much of the pending output as the outgoing body can currently accept. Returns
+  // `false` if the body's stream errored.
+  bool write_pending() {
+    while (written_ < pending_.size()) {
+      auto res = outgoing_body_->capacity();
+      if (res.is_err()) {
+        return false;
+      }
+      auto len = static_cast<size_t>(std::min<uint64_t>(res.unwrap(), pending_.size() - written_));
+      if (len == 0) {
+        return true;
+      }
+      outgoing_body_->write(pending_.data() + written_, len);
+      written_ += len;
+    }
+    pending_.clear();
+    written_ = 0;
+    return true;
+  }
+
+  // Passes `len` bytes of `input` through all stages, appending the last stage's output to
+  // `pending_`. If `finish` is set, each stage is finished after transforming its input.
+  bool transform(JSContext *cx, const uint8_t *input, size_t len, bool finish) {
+    RootedObject transformer(cx);
+    for (size_t i = 0; i < stages_.size(); i++) {
+      auto &out = i + 1 < stages_.size() ? stage_output_[i] : pending_;
+      if (i + 1 < stages_.size()) {
+        out.clear();
+      }
+      transformer = stages_[i].transformer;
+      if (len > 0 && !stages_[i].transform(cx, transformer, input, len, false, out)) {
+        return false;
+      }
+      if (finish && !stages_[i].transform(cx, transformer, nullptr, 0, true, out)) {
+        return false;
+      }
+      input = out.data();
+      len = out.size();
+    }
+    return true;
+  }
+
+  bool finish(JSContext *cx) {
+    state_ = State::Done;
+    RootedObject receiver(cx, cb_receiver_);
+    cb_receiver_ = nullptr;
+    return cb_(cx, receiver);
+  }
+
+  // Errors the TransformStream with the pending exception, which in turn cancels the source and
+  // errors the stream the outgoing body is read from.
+  bool fail(JSContext *cx) {
+    state_ = State::Done;
+    RootedValue exn(cx);
+    if (!JS_GetPendingException(cx, &exn)) {
+      return false;
+    }
+    JS_ClearPendingException(cx);
+    RootedObject transform_stream(cx, transform_stream_);
+    return streams::TransformStream::Error(cx, transform_stream, exn);
+  }
+
+public:
+  BodyTransformTask(JSContext *cx, HandleObject transform_stream, HandleObject source,
+                    HandleObject dest, api::TaskCompletionCallback completion_callback,
+                    HandleObject callback_receiver)
+      : transform_stream_(transform_stream),
+        source_kind_(Request::is_instance(source) ? "request" : "response"),
+        dest_kind_(Request::is_instance(dest) ? "request" : "response"),
+        incoming_body_(RequestOrResponse::incoming_body_handle(source)),
+        outgoing_body_(RequestOrResponse::outgoing_body_handle(dest)), cb_(completion_callback),
+        cb_receiver_(callback_receiver) {
+    incoming_pollable_ = incoming_body_->subscribe().unwrap();
+    outgoing_pollable_ = outgoing_body_->subscribe().unwrap();
+
+    // Collect the native transforms of all streams up to the one whose readable is used as `dest`'s
+    // body. Streams without a native transform are identity streams, which are skipped.
+    RootedObject stream(cx, transform_stream);
+    while (true) {
+      if (auto *transformer = streams::TransformStream::native_transformer(stream)) {
+        stages_.emplace_back(transformer,
+                             streams::TransformStream::native_transform_algorithm(stream));
+      }
+      if (streams::TransformStream::readable_used_as_body(stream)) {
+        break;
+      }
+      stream = readable_piped_to(cx, stream);
+      MOZ_ASSERT(stream);
+    }
+    MOZ_ASSERT(!stages_.empty());
+    stage_output_.resize(stages_.size() - 1);
+  }
+
+  [[nodiscard]] bool run(api::Engine *engine) override {
+    JSContext *cx = engine->cx();
+
+    while (true) {
+      if (!write_pending()) {
+        api::throw_error(cx, FetchErrors::OutgoingBodyStreamError, dest_kind_);
+        return fail(cx);
+      }
+      if (!pending_.empty()) {
+        state_ = State::BlockedOnOutgoing;
+        engine->queue_async_task(this);
+        return true;
+      }
+      if (input_done_) {
+        return finish(cx);
+      }
+
+      auto res = incoming_body_->read(HANDLE_READ_CHUNK_SIZE);
+      if (res.is_err()) {
+        api::throw_error(cx, FetchErrors::IncomingBodyStreamError, source_kind_);
+        return fail(cx);
+      }
+      auto [done, bytes] = std::move(res.unwrap());
+      if (done) {
+        input_done_ = true;
+      } else if (bytes.len == 0) {
+        state_ = State::BlockedOnIncoming;
+        engine->queue_async_task(this);
+        return true;
+      }
+
+      if (!transform(cx, bytes.ptr.get(), bytes.len, done)) {
+        return fail(cx);
+      }
+    }
+  }
+
+  // Only used if the outgoing body is closed while the task waits for buffered writes, before it
+  // ever ran. The TransformStream is then errored, as if writing to the body had failed.
+  [[nodiscard]] bool cancel(api::Engine *engine) override {
+    JSContext *cx = engine->cx();
+    api::throw_error(cx, FetchErrors::OutgoingBodyStreamError, dest_kind_);
+    return fail(cx);
+  }
+
+  [[nodiscard]] int32_t id() override {
+    MOZ_ASSERT(state_ != State::Done,
+               "BodyTransformTask should only be queued if it's not known to be ready");
+    return state_ == State::BlockedOnIncoming ? incoming_pollable_ : outgoing_pollable_;
+  }
+
+  [[nodiscard]] const char *name() const override { return "BodyTransformTask"; }
+
+  void trace(JSTracer *trc) override {
+    TraceEdge(trc, &transform_stream_, "transform stream for body transform task");
+    for (auto &stage : stages_) {
+      TraceEdge(trc, &stage.transformer, "native transformer for body transform task");
+    }
+    TraceEdge(trc, &cb_receiver_, "completion callback receiver for body transform task");
+  }
+};
+
 namespace {
 // https://fetch.spec.whatwg.org/#concept-method-normalize
 // Returns `true` if the method name was normalized, `false` otherwise.
@@ -371,9 +844,10 @@ bool RequestOrResponse::extract_body(JSContext *cx, JS::HandleObject self,
     // TransformStreams later on.
     if (streams::TransformStream::is_ts_readable(cx, body_obj)) {
       // But only if the TransformStream isn't used as a mixin by other
-      // builtins.
-      if (!streams::TransformStream::used_as_mixin(
-              streams::TransformStream::ts_from_readable(cx, body_obj))) {
+      // builtins, or if those builtins can apply their transform natively.
+      JSObject *ts = streams::TransformStream::ts_from_readable(cx, body_obj);
+      if (!streams::TransformStream::used_as_mixin(ts) ||
+          streams::TransformStream::native_transformer(ts)) {
         streams::TransformStream::set_readable_used_as_body(cx, body_obj, self);
       }
     }
@@ -407,11 +881,11 @@ bool RequestOrResponse::extract_body(JSContext *cx, JS::HandleObject self,
       content_type = "application/x-www-form-urlencoded;charset=UTF-8"sv;
     } else {
       auto text = core::encode(cx, body_val);
-      if (!text.ptr) {
+      if (!text) {
         return false;
       }
-      buf = text.ptr.release();
       length = text.len;
+      buf = text.release().release();
       content_type = "text/plain;charset=UTF-8"sv;
     }
 
@@ -561,6 +1035,28 @@ bool RequestOrResponse::append_body(JSContext *cx, JS::HandleObject self, JS::Ha
   return true;
 }
 
+bool RequestOrResponse::transform_body(JSContext *cx, JS::HandleObject self,
+                                       JS::HandleObject source, JS::HandleObject transform_stream,
+                                       api::TaskCompletionCallback callback,
+                                       HandleObject callback_receiver) {
+  MOZ_ASSERT(!body_used(source));
+  MOZ_ASSERT(self != source);
+  // Chunks written to the destination from JS might still be buffered, and have to be written
+  // before any of the transformed source body.
+  outgoing_body_handle(self)->queue_after_writes(
+      ENGINE,
+      js_new<BodyTransformTask>(cx, transform_stream, source, self, callback, callback_receiver));
+
+  mozilla::DebugOnly<bool> success = mark_body_used(cx, source);
+  MOZ_ASSERT(success);
+  if (!body_used(self)) {
+    success = mark_body_used(cx, self);
+    MOZ_ASSERT(success);
+  }
+
+  return true;
+}
+
 JSObject *RequestOrResponse::headers(JSContext *cx, JS::HandleObject obj) {
   JSObject *headers = maybe_headers(obj);
   if (headers == nullptr) {
@@ -591,6 +1087,19 @@ JSObject *RequestOrResponse::headers(JSContext *cx, JS::HandleObject obj) {
   return headers;
 }
 
+namespace {
+// Returns the headers for the `headers` accessor. Content is about to inspect them, so headers
+// backed by an incoming request or response are retrieved from the host with a single call,
+// instead of with one call for every lookup.
+JSObject *headers_for_content(JSContext *cx, JS::HandleObject self) {
+  RootedObject headers(cx, RequestOrResponse::headers(cx, self));
+  if (!headers || (RequestOrResponse::is_incoming(self) && !Headers::get_list(cx, headers))) {
+    return nullptr;
+  }
+  return headers;
+}
+} // namespace
+
 // https://fetch.spec.whatwg.org/#body-mixin
 template <RequestOrResponse::BodyReadResult result_type>
 bool RequestOrResponse::parse_body(JSContext *cx, JS::HandleObject self, JS::UniqueChars buf,
@@ -672,6 +1181,31 @@ bool RequestOrResponse::parse_body(JSContext *cx, JS::HandleObject self, JS::Uni
   return JS::ResolvePromise(cx, result_promise, result);
 }
 
+template <RequestOrResponse::BodyReadResult result_type>
+bool RequestOrResponse::parse_text_body(JSContext *cx, JS::HandleObject self,
+                                        JS::UniqueTwoByteChars chars, size_t len) {
+  static_assert(result_type == RequestOrResponse::BodyReadResult::Text ||
+                result_type == RequestOrResponse::BodyReadResult::JSON);
+  JS::RootedObject result_promise(cx, take_body_all_promise(self));
+  JS::RootedValue result(cx);
+
+  if constexpr (result_type == RequestOrResponse::BodyReadResult::Text) {
+    JS::RootedString text(cx, len ? JS_NewUCString(cx, std::move(chars), len)
+                                  : JS_GetEmptyString(cx));
+    if (!text) {
+      return RejectPromiseWithPendingError(cx, result_promise);
+    }
+    result.setString(text);
+  } else {
+    // Parse straight from the decoded buffer, without first creating a string from it.
+    if (!JS_ParseJSON(cx, len ? chars.get() : u"", len, &result)) {
+      return RejectPromiseWithPendingError(cx, result_promise);
+    }
+  }
+
+  return JS::ResolvePromise(cx, result_promise, result);
+}
+
 bool RequestOrResponse::content_stream_read_then_handler(JSContext *cx, JS::HandleObject self,
                                                          JS::HandleValue extra, JS::CallArgs args) {
   JS::RootedObject then_handler(cx, &args.callee());
@@ -946,9 +1480,25 @@ bool RequestOrResponse::bodyAll(JSContext *cx, JS::CallArgs args, JS::HandleObje
     return true;
   }
 
+  // Incoming bodies that haven't been exposed as a ReadableStream can be read without one.
+  if (is_incoming(self) && !body_stream(self)) {
+    RefPtr<BodyDrainTask> task;
+    if constexpr (result_type == BodyReadResult::Text || result_type == BodyReadResult::JSON) {
+      task = js_new<BodyDrainTask>(self, parse_text_body<result_type>);
+    } else {
+      task = js_new<BodyDrainTask>(self, parse_body<result_type>);
+    }
+    if (!task->presize(cx)) {
+      return ReturnPromiseRejectedWithPendingError(cx, args);
+    }
+    SetReservedSlot(self, static_cast<uint32_t>(Slots::BodyUsed), JS::BooleanValue(true));
+    ENGINE->queue_async_task(task);
+    args.rval().setObject(*bodyAll_promise);
+    return true;
+  }
+
   JS::RootedValue body_parser(cx, JS::PrivateValue((void *)parse_body<result_type>));
 
-  // TODO(performance): don't reify a ReadableStream for body handles—use an AsyncTask instead
   JS::RootedObject stream(cx, body_stream(self));
   if (!stream) {
     if (!(stream = create_body_stream(cx, self))) {
@@ -981,6 +1531,35 @@ bool close_appended_body(JSContext *cx, HandleObject body_owner) {
   return ReadableStreamClose(cx, body);
 }
 
+/**
+ * Follows the TransformStreams piped into each other starting with |transform_stream|, as set up by
+ * e.g. `body.pipeThrough(new DecompressionStream('gzip')).pipeThrough(new CompressionStream('br'))`,
+ * to the one whose readable end is used as a body.
+ *
+ * Returns nullptr if the chain doesn't end in a body that's being streamed to the host, or if any
+ * of its streams is used by a builtin that can only transform chunks in JS. Bodies of requests or
+ * responses that are instead read from JS, e.g. using `Response#text`, don't have an outgoing
+ * handle to write to, so the chain is then run in JS. Otherwise, sets |transforms| if any of the
+ * streams has a native transform.
+ */
+JSObject *native_pipe_end(JSContext *cx, HandleObject transform_stream, bool *transforms) {
+  *transforms = false;
+  RootedObject stream(cx, transform_stream);
+  while (stream) {
+    if (streams::TransformStream::native_transformer(stream)) {
+      *transforms = true;
+    } else if (streams::TransformStream::used_as_mixin(stream)) {
+      return nullptr;
+    }
+    if (streams::TransformStream::readable_used_as_body(stream)) {
+      JSObject *owner = streams::TransformStream::owner(stream);
+      return RequestOrResponse::maybe_handle(owner) ? stream.get() : nullptr;
+    }
+    stream = readable_piped_to(cx, stream);
+  }
+  return nullptr;
+}
+
 bool do_body_source_pull(JSContext *cx, HandleObject source, HandleObject body_owner) {
   // If the stream has been piped to a TransformStream whose readable end was
   // then passed to a Request or Response as the body, we can just append the
@@ -992,12 +1571,26 @@ bool do_body_source_pull(JSContext *cx, HandleObject source, HandleObject body_o
   // ReadableStream#pipeTo locks the destination WritableStream until the
   // source ReadableStream is closed/canceled, so only one stream can ever be
   // piped in at the same time.
+  //
+  // The same applies to TransformStreams with a native transform, such as the
+  // ones used by CompressionStream and DecompressionStream, and to chains of
+  // such streams piped into each other: the source body is then read,
+  // transformed by each stream in turn, and written to the destination by a
+  // single native task, without any of the chunks passing through JS.
   RootedObject pipe_dest(cx, streams::NativeStreamSource::piped_to_transform_stream(source));
-  if (pipe_dest && streams::TransformStream::readable_used_as_body(pipe_dest)) {
+  bool transforms = false;
+  RootedObject pipe_end(cx, pipe_dest ? native_pipe_end(cx, pipe_dest, &transforms) : nullptr);
+  if (pipe_end) {
     MOZ_ASSERT(!streams::TransformStream::backpressure(pipe_dest));
-    RootedObject dest_owner(cx, streams::TransformStream::owner(pipe_dest));
+    RootedObject dest_owner(cx, streams::TransformStream::owner(pipe_end));
     MOZ_ASSERT(!JS_IsExceptionPending(cx));
-    if (!RequestOrResponse::append_body(cx, dest_owner, body_owner, close_appended_body, body_owner)) {
+    if (transforms) {
+      if (!RequestOrResponse::transform_body(cx, dest_owner, body_owner, pipe_dest,
+                                             close_appended_body, body_owner)) {
+        return false;
+      }
+    } else if (!RequestOrResponse::append_body(cx, dest_owner, body_owner, close_appended_body,
+                                               body_owner)) {
       return false;
     }
 
@@ -1090,7 +1683,16 @@ bool reader_for_outgoing_body_then_handler(JSContext *cx, JS::HandleObject body_
   }
 
   if (done_val.toBoolean()) {
-    return finish_outgoing_body_streaming(cx, body_owner);
+    // Chunks might still be queued for writing, so wait for those before finishing the body.
+    auto res = body->flush(ENGINE, finish_outgoing_body_streaming, body_owner);
+    if (const auto *err = res.to_err()) {
+      HANDLE_ERROR(cx, *err);
+      return false;
+    }
+    if (res.unwrap()) {
+      return finish_outgoing_body_streaming(cx, body_owner);
+    }
+    return true;
   }
 
   JS::RootedValue val(cx);
@@ -1159,12 +1761,17 @@ bool reader_for_outgoing_body_then_handler(JSContext *cx, JS::HandleObject body_
     bytes = host_api::HostBytes(unique_ptr<uint8_t[]>(ptr), length);
   }
 
+  // Chunks are buffered, so the next one can usually be read right away. That allows multiple
+  // small chunks to be coalesced into a single write.
   auto res = body->write_all(ENGINE, std::move(bytes),
     write_all_finish_callback, then_handler);
   if (const auto *err = res.to_err()) {
     HANDLE_ERROR(cx, *err);
     return false;
   }
+  if (res.unwrap()) {
+    return write_all_finish_callback(cx, then_handler);
+  }
 
   return true;
 }
@@ -1183,6 +1790,36 @@ bool reader_for_outgoing_body_catch_handler(JSContext *cx, JS::HandleObject body
   return finish_outgoing_body_streaming(cx, body_owner);
 }
 
+/**
+ * Returns the incoming Request or Response |stream| is the body stream of, if content hasn't read
+ * from it, locked it, or piped it anywhere. Content then can't have observed any of its chunks, so
+ * the body can be forwarded without going through the stream.
+ */
+JSObject *untouched_incoming_body_owner(JSContext *cx, JS::HandleObject stream) {
+  if (!streams::NativeStreamSource::stream_is_body(cx, stream) ||
+      RequestOrResponse::body_unusable(cx, stream)) {
+    return nullptr;
+  }
+  RootedObject source(cx, streams::NativeStreamSource::get_stream_source(cx, stream));
+  JSObject *owner = streams::NativeStreamSource::owner(source);
+  if (!RequestOrResponse::is_incoming(owner) || RequestOrResponse::body_used(owner)) {
+    return nullptr;
+  }
+  return owner;
+}
+
+/**
+ * Closes the forwarded body stream of |body_owner| once its source body has been appended, and then
+ * finishes |body_owner|'s outgoing body.
+ */
+bool finish_forwarded_body_stream(JSContext *cx, HandleObject body_owner) {
+  RootedObject stream(cx, RequestOrResponse::body_stream(body_owner));
+  if (!ReadableStreamClose(cx, stream)) {
+    return false;
+  }
+  return finish_outgoing_body_streaming(cx, body_owner);
+}
+
 bool RequestOrResponse::maybe_stream_body(JSContext *cx, JS::HandleObject body_owner,
                                           host_api::HttpOutgoingBodyOwner *destination,
                                           bool *requires_streaming) {
@@ -1217,6 +1854,27 @@ bool RequestOrResponse::maybe_stream_body(JSContext *cx, JS::HandleObject body_o
     return api::throw_error(cx, FetchErrors::BodyStreamUnusable);
   }
 
+  // The same applies to the body stream of an incoming request or response that content passed
+  // on as-is, as in `fetch(url, { method: 'POST', body: request.body })`. Reading it through a JS
+  // reader would create an ArrayBuffer and a Uint8Array for every chunk of the upload.
+  JS::RootedObject source_owner(cx, untouched_incoming_body_owner(cx, stream));
+  if (source_owner) {
+    auto *source_body = incoming_body_handle(source_owner);
+    auto *dest_body = destination->body().unwrap();
+    // Marking the source's body as used locks the stream, so content can't read it anymore.
+    if (!mark_body_used(cx, source_owner)) {
+      return false;
+    }
+    auto res = dest_body->append(ENGINE, source_body, finish_forwarded_body_stream, body_owner);
+    if (const auto *err = res.to_err()) {
+      HANDLE_ERROR(cx, *err);
+      return false;
+    }
+
+    *requires_streaming = true;
+    return true;
+  }
+
   JS::RootedObject reader(
       cx, JS::ReadableStreamGetReader(cx, stream, JS::ReadableStreamReaderMode::Default));
   if (!reader) {
@@ -1338,7 +1996,7 @@ bool Request::url_get(JSContext *cx, unsigned argc, JS::Value *vp) {
 bool Request::headers_get(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER(0)
 
-  JSObject *headers = RequestOrResponse::headers(cx, self);
+  JSObject *headers = headers_for_content(cx, self);
   if (!headers) {
     return false;
   }
@@ -2287,7 +2945,7 @@ bool Response::redirected_get(JSContext *cx, unsigned argc, JS::Value *vp) {
 bool Response::headers_get(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER(0)
 
-  JSObject *headers = RequestOrResponse::headers(cx, self);
+  JSObject *headers = headers_for_content(cx, self);
   if (!headers) {
     return false;
   }
@@ -72,7 +72,18 @@ public:
   static bool append_body(JSContext *cx, JS::HandleObject self, JS::HandleObject source,
                           api::TaskCompletionCallback callback, HandleObject callback_receiver);
 
+  /**
+   * Like `append_body`, but passing the source body through the native transforms of the given
+   * TransformStream and of all TransformStreams its readable end is piped through on the way.
+   */
+  static bool transform_body(JSContext *cx, JS::HandleObject self, JS::HandleObject source,
+                             JS::HandleObject transform_stream,
+                             api::TaskCompletionCallback callback,
+                             HandleObject callback_receiver);
+
   using ParseBodyCB = bool(JSContext *cx, JS::HandleObject self, JS::UniqueChars buf, size_t len);
+  using ParseTextBodyCB = bool(JSContext *cx, JS::HandleObject self, JS::UniqueTwoByteChars chars,
+                               size_t len);
 
   enum class BodyReadResult : uint8_t {
     ArrayBuffer,
@@ -85,6 +96,15 @@ public:
   template <BodyReadResult result_type>
   static bool parse_body(JSContext *cx, JS::HandleObject self, JS::UniqueChars buf, size_t len);
 
+  /**
+   * Like `parse_body`, but for bodies that have already been decoded from UTF-8.
+   *
+   * Only valid for `BodyReadResult::Text` and `BodyReadResult::JSON`.
+   */
+  template <BodyReadResult result_type>
+  static bool parse_text_body(JSContext *cx, JS::HandleObject self, JS::UniqueTwoByteChars chars,
+                              size_t len);
+
   static bool content_stream_read_then_handler(JSContext *cx, JS::HandleObject self,
                                                JS::HandleValue extra, JS::CallArgs args);
   static bool content_stream_read_catch_handler(JSContext *cx, JS::HandleObject self,
@@ -249,6 +269,8 @@ public:
   [[nodiscard]] bool cancel(api::Engine *engine) override;
   [[nodiscard]] bool abort(api::Engine *engine);
 
+  [[nodiscard]] const char *name() const override { return "ResponseFutureTask"; }
+
   void trace(JSTracer *trc) override { TraceEdge(trc, &request_, "Request for response future"); }
 };
 
@@ -82,6 +82,8 @@ public:
     return true;
   }
 
+  [[nodiscard]] const char *name() const override { return "StreamTask"; }
+
   void trace(JSTracer *trc) override { TraceEdge(trc, &reader_, "Reader for BufReader StreamTask"); }
 };
 
@@ -1,5 +1,7 @@
+#include "brotli/encode.h"
 #include "js/experimental/TypedData.h"
 #include "zlib.h"
+#include "zstd.h"
 
 #include "compression-stream.h"
 #include "encode.h"
@@ -17,11 +19,35 @@ enum class Format : uint8_t {
   GZIP,
   Deflate,
   DeflateRaw,
+  Brotli,
+  Zstd,
 };
 
+// The zlib parameters used to set up the deflate state.
+//
+// `window_bits` is the base-two logarithm of the window size, independent of the format: the
+// adjustments zlib expects for gzip and raw deflate streams are applied when the state is set up.
+struct DeflateParams {
+  int level;
+  int window_bits;
+  int mem_level;
+};
+
+// The parameters used unless overridden by the initializer script or, if enabled, the options bag
+// passed to the constructor. These only apply to the zlib-based formats.
+//
 // Using compression level 2, as per the reasoning here:
 // https://searchfox.org/mozilla-central/rev/ecd91b104714a8b2584a4c03175be50ccb3a7c67/dom/fetch/FetchUtil.cpp#603-609
-constexpr int COMPRESSION_LEVEL = 2;
+// Using the same window bits as Chromium's Compression stream, see
+// https://chromium.googlesource.com/chromium/src/+/457f48d3d8635c8bca077232471228d75290cc29/third_party/blink/renderer/modules/compression/deflate_transformer.cc#31
+DeflateParams DEFAULT_PARAMS = {2, 15, 8};
+
+// Brotli's highest qualities are far too slow for compressing on the fly. Quality 5 is what most
+// servers use for dynamic content, with a ratio comparable to gzip's best at a fraction of the cost.
+constexpr uint32_t BROTLI_QUALITY = 5;
+
+// Using zstd's default level, which is already faster than gzip's default while compressing better.
+constexpr int ZSTD_LEVEL = ZSTD_CLEVEL_DEFAULT;
 
 // Using the same fixed encoding buffer size as Chromium, see
 // https://chromium.googlesource.com/chromium/src/+/457f48d3d8635c8bca077232471228d75290cc29/third_party/blink/renderer/modules/compression/deflate_transformer.cc#29
@@ -32,11 +58,18 @@ JSObject *transform(JSObject *self) {
   return &JS::GetReservedSlot(self, CompressionStream::Slots::Transform).toObject();
 }
 
-z_stream *state(JSObject *self) {
+Format format(JSObject *self) {
+  MOZ_ASSERT(CompressionStream::is_instance(self));
+  return static_cast<Format>(JS::GetReservedSlot(self, CompressionStream::Slots::Format).toInt32());
+}
+
+// The compressor state, which is a `z_stream`, `BrotliEncoderState`, or `ZSTD_CStream` depending
+// on the format.
+void *state(JSObject *self) {
   MOZ_ASSERT(CompressionStream::is_instance(self));
   void *ptr = JS::GetReservedSlot(self, CompressionStream::Slots::State).toPrivate();
   MOZ_ASSERT(ptr);
-  return (z_stream *)ptr;
+  return ptr;
 }
 
 uint8_t *output_buffer(JSObject *self) {
@@ -49,11 +82,77 @@ uint8_t *output_buffer(JSObject *self) {
 JS::PersistentRooted<JSObject *> transformAlgo;
 JS::PersistentRooted<JSObject *> flushAlgo;
 
+// Runs the compressor once, consuming as much of the input as it can and filling at most one
+// output buffer.
+//
+// On return, `input` and `avail_in` are advanced past the consumed input, `written` holds the
+// number of bytes written to `buffer`, and `more` is set if the compressor has to be run again
+// to consume the remaining input, or to produce the remaining output.
+bool compress_step(JSContext *cx, JSObject *self, const uint8_t **input, size_t *avail_in,
+                   uint8_t *buffer, bool finish, size_t *written, bool *more) {
+  switch (format(self)) {
+  case Format::GZIP:
+  case Format::Deflate:
+  case Format::DeflateRaw: {
+    // See the zlib docs for details on how `deflate` consumes input and produces output:
+    // https://searchfox.org/mozilla-central/rev/87ecd21d3ca517f8d90e49b32bf042a754ed8f18/modules/zlib/src/zlib.h#319-324
+    auto *zstream = static_cast<z_stream *>(state(self));
+    zstream->next_in = const_cast<uint8_t *>(*input);
+    zstream->avail_in = *avail_in;
+    zstream->next_out = buffer;
+    zstream->avail_out = BUFFER_SIZE;
+    int err = deflate(zstream, finish ? Z_FINISH : Z_NO_FLUSH);
+    if ((!finish || err != Z_STREAM_END) && err != Z_OK) {
+      return api::throw_error(cx, StreamErrors::CompressingChunkFailed);
+    }
+    *input = zstream->next_in;
+    *avail_in = zstream->avail_in;
+    *written = BUFFER_SIZE - zstream->avail_out;
+    *more = zstream->avail_out == 0;
+    return true;
+  }
+  case Format::Brotli: {
+    auto *encoder = static_cast<BrotliEncoderState *>(state(self));
+    size_t avail_out = BUFFER_SIZE;
+    uint8_t *next_out = buffer;
+    auto op = finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
+    if (!BrotliEncoderCompressStream(encoder, op, avail_in, input, &avail_out, &next_out,
+                                     nullptr)) {
+      return api::throw_error(cx, StreamErrors::CompressingChunkFailed);
+    }
+    *written = BUFFER_SIZE - avail_out;
+    *more = *avail_in != 0 || BrotliEncoderHasMoreOutput(encoder) ||
+            (finish && !BrotliEncoderIsFinished(encoder));
+    return true;
+  }
+  case Format::Zstd: {
+    auto *cstream = static_cast<ZSTD_CStream *>(state(self));
+    ZSTD_inBuffer in = {*input, *avail_in, 0};
+    ZSTD_outBuffer out = {buffer, BUFFER_SIZE, 0};
+    // With `ZSTD_e_end`, the result is the number of bytes left to flush.
+    size_t remaining =
+        ZSTD_compressStream2(cstream, &out, &in, finish ? ZSTD_e_end : ZSTD_e_continue);
+    if (ZSTD_isError(remaining)) {
+      return api::throw_error(cx, StreamErrors::CompressingChunkFailed);
+    }
+    *input += in.pos;
+    *avail_in -= in.pos;
+    *written = out.pos;
+    *more = finish ? remaining != 0 : (*avail_in != 0 || out.pos == out.size);
+    return true;
+  }
+  }
+
+  MOZ_ASSERT_UNREACHABLE("Invalid compression format");
+  return false;
+}
+
 } // namespace
 
 // Steps 1-5 of the transform algorithm, and 1-4 of the flush algorithm.
-bool deflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk, bool finished) {
-  z_stream *zstream = state(self);
+bool compress_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk, bool finished) {
+  const uint8_t *input = nullptr;
+  size_t avail_in = 0;
 
   if (!finished) {
     // 1.  If _chunk_ is not a `BufferSource` type, then throw a `TypeError`.
@@ -70,22 +169,19 @@ bool deflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk,
     // 2.  Let _buffer_ be the result of compressing _chunk_ with _cs_'s format
     // and context. This just sets up step 2. The actual compression happen in
     // the `do` loop below.
-    zstream->avail_in = data->size();
-
+    //
     // `data` is a live view into `chunk`. That's ok here because it'll be fully
     // used in the `do` loop below before any content can execute again and
     // could potentially invalidate the pointer to `data`.
-    zstream->next_in = data->data();
-  } else {
-    // Step 1 of flush:
-    // 1.  Let _buffer_ be the result of compressing an empty input with _cs_'s
-    // format and
-    //     context, with the finish flag.
-    // This just sets up step 2. The actual compression happen in the `do` loop
-    // below.
-    zstream->avail_in = 0;
-    zstream->next_in = nullptr;
+    input = data->data();
+    avail_in = data->size();
   }
+  // Step 1 of flush:
+  // 1.  Let _buffer_ be the result of compressing an empty input with _cs_'s
+  // format and
+  //     context, with the finish flag.
+  // This just sets up step 2. The actual compression happen in the `do` loop
+  // below.
 
   JS::RootedObject controller(cx, TransformStream::controller(transform(self)));
 
@@ -96,25 +192,20 @@ bool deflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk,
 
   uint8_t *buffer = output_buffer(self);
 
-  // Call `deflate` in a loop, enqueuing compressed chunks until the input
-  // buffer has been fully consumed. That is the case when `zstream->avail_out`
-  // is non-zero, i.e. when the last chunk wasn't completely filled. See zlib
-  // docs for details:
-  // https://searchfox.org/mozilla-central/rev/87ecd21d3ca517f8d90e49b32bf042a754ed8f18/modules/zlib/src/zlib.h#319-324
+  // Run the compressor in a loop, enqueuing compressed chunks until the input
+  // has been fully consumed and all output it produced has been enqueued.
+  bool more = false;
   do {
     // 4.  Split _buffer_ into one or more non-empty pieces and convert them
     // into `Uint8Array`s.
     // 5.  For each `Uint8Array` _array_, enqueue _array_ in _cs_'s transform.
     // This loop does the actual compression, one output-buffer sized chunk at a
     // time, and then creates and enqueues the Uint8Arrays immediately.
-    zstream->avail_out = BUFFER_SIZE;
-    zstream->next_out = buffer;
-    int err = deflate(zstream, finished ? Z_FINISH : Z_NO_FLUSH);
-    if ((!finished || err != Z_STREAM_END) && err != Z_OK) {
-      return api::throw_error(cx, StreamErrors::CompressingChunkFailed);
+    size_t bytes = 0;
+    if (!compress_step(cx, self, &input, &avail_in, buffer, finished, &bytes, &more)) {
+      return false;
     }
 
-    size_t bytes = BUFFER_SIZE - zstream->avail_out;
     if (bytes != 0U) {
       JS::RootedObject out_obj(cx, JS_NewUint8Array(cx, bytes));
       if (out_obj == nullptr) {
@@ -135,17 +226,80 @@ bool deflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk,
     }
 
     // 3.  If _buffer_ is empty, return.
-  } while (zstream->avail_out == 0);
+  } while (more);
 
   return true;
 }
 
+namespace {
+
+// Frees the compressor state and output buffer, as far as they have been set up.
+void free_state(JSObject *self) {
+  JS::Value state_val = JS::GetReservedSlot(self, CompressionStream::Slots::State);
+  if (!state_val.isUndefined() && state_val.toPrivate()) {
+    switch (format(self)) {
+    case Format::GZIP:
+    case Format::Deflate:
+    case Format::DeflateRaw: {
+      auto *zstream = static_cast<z_stream *>(state_val.toPrivate());
+      deflateEnd(zstream);
+      js_free(zstream);
+      break;
+    }
+    case Format::Brotli:
+      BrotliEncoderDestroyInstance(static_cast<BrotliEncoderState *>(state_val.toPrivate()));
+      break;
+    case Format::Zstd:
+      ZSTD_freeCStream(static_cast<ZSTD_CStream *>(state_val.toPrivate()));
+      break;
+    }
+  }
+
+  JS::Value buffer_val = JS::GetReservedSlot(self, CompressionStream::Slots::Buffer);
+  if (!buffer_val.isUndefined()) {
+    js_free(buffer_val.toPrivate());
+  }
+}
+
+// Releases the compressor state and output buffer once all output has been flushed.
+void finish_compression(JSObject *self) {
+  free_state(self);
+  JS::SetReservedSlot(self, CompressionStream::Slots::State, JS::PrivateValue(nullptr));
+  JS::SetReservedSlot(self, CompressionStream::Slots::Buffer, JS::PrivateValue(nullptr));
+}
+
+bool finished(JSObject *self) {
+  return JS::GetReservedSlot(self, CompressionStream::Slots::State).toPrivate() == nullptr;
+}
+
+// Native equivalent of `compress_chunk`, used for native-to-native pipes: the same steps, but
+// appending the output to `out` instead of enqueuing it as Uint8Arrays.
+bool compress_bytes(JSContext *cx, JS::HandleObject self, const uint8_t *input, size_t len,
+                    bool finish, std::vector<uint8_t> &out) {
+  uint8_t *buffer = output_buffer(self);
+  bool more = false;
+  do {
+    size_t bytes = 0;
+    if (!compress_step(cx, self, &input, &len, buffer, finish, &bytes, &more)) {
+      return false;
+    }
+    out.insert(out.end(), buffer, buffer + bytes);
+  } while (more);
+
+  if (finish) {
+    finish_compression(self);
+  }
+  return true;
+}
+
+} // namespace
+
 // https://wicg.github.io/compression/#compress-and-enqueue-a-chunk
-// All steps inlined into `deflate_chunk`.
+// All steps inlined into `compress_chunk`.
 bool CompressionStream::transformAlgorithm(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER_WITH_NAME(1, "Compression stream transform algorithm")
 
-  if (!deflate_chunk(cx, self, args[0], false)) {
+  if (!compress_chunk(cx, self, args[0], false)) {
     return false;
   }
 
@@ -154,28 +308,30 @@ bool CompressionStream::transformAlgorithm(JSContext *cx, unsigned argc, JS::Val
 }
 
 // https://wicg.github.io/compression/#compress-flush-and-enqueue
-// All steps inlined into `deflate_chunk`.
+// All steps inlined into `compress_chunk`.
 bool CompressionStream::flushAlgorithm(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER_WITH_NAME(0, "Compression stream flush algorithm")
 
-  if (!deflate_chunk(cx, self, JS::UndefinedHandleValue, true)) {
-    return false;
+  // If the input was piped in natively, all output has already been flushed as well.
+  if (finished(self)) {
+    args.rval().setUndefined();
+    return true;
   }
 
-  deflateEnd(state(self));
-  JS_free(cx, output_buffer(self));
+  if (!compress_chunk(cx, self, JS::UndefinedHandleValue, true)) {
+    return false;
+  }
 
-// These fields shouldn't ever be accessed again, but we should be able to
-// assert that.
-#ifdef DEBUG
-  JS::SetReservedSlot(self, Slots::State, JS::PrivateValue(nullptr));
-  JS::SetReservedSlot(self, Slots::Buffer, JS::PrivateValue(nullptr));
-#endif
+  finish_compression(self);
 
   args.rval().setUndefined();
   return true;
 }
 
+// Streams that are errored, cancelled, or dropped before being flushed still hold their compressor
+// state, which is released here.
+void CompressionStream::finalize(JS::GCContext *gcx, JSObject *self) { free_state(self); }
+
 bool CompressionStream::readable_get(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER_WITH_NAME(0, "get readable")
   args.rval().setObject(*TransformStream::readable(transform(self)));
@@ -210,7 +366,8 @@ const JSPropertySpec CompressionStream::properties[] = {
 namespace {
 
 // Steps 2-6 of `new CompressionStream()`.
-JSObject *create(JSContext *cx, JS::HandleObject stream, Format format) {
+JSObject *create(JSContext *cx, JS::HandleObject stream, Format format,
+                 const DeflateParams &params) {
   JS::RootedValue stream_val(cx, JS::ObjectValue(*stream));
 
   // 2.  Set this's format to _format_.
@@ -235,38 +392,65 @@ JSObject *create(JSContext *cx, JS::HandleObject stream, Format format) {
   }
 
   TransformStream::set_used_as_mixin(transform);
+  TransformStream::set_native_transform(transform, stream, compress_bytes);
   JS::SetReservedSlot(stream, CompressionStream::Slots::Transform, JS::ObjectValue(*transform));
 
-  // The remainder of the function deals with setting up the deflate state used
+  // The remainder of the function deals with setting up the compressor state used
   // for compressing chunks.
-  auto *zstream = (z_stream *)JS_malloc(cx, sizeof(z_stream));
-  if (!zstream) {
+  auto *buffer = (uint8_t *)JS_malloc(cx, BUFFER_SIZE);
+  if (!buffer) {
     JS_ReportOutOfMemory(cx);
     return nullptr;
   }
 
-  memset(zstream, 0, sizeof(z_stream));
-  JS::SetReservedSlot(stream, CompressionStream::Slots::State, JS::PrivateValue(zstream));
+  JS::SetReservedSlot(stream, CompressionStream::Slots::Buffer, JS::PrivateValue(buffer));
 
-  auto *buffer = (uint8_t *)JS_malloc(cx, BUFFER_SIZE);
-  if (!buffer) {
+  if (format == Format::Brotli) {
+    BrotliEncoderState *encoder = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+    if (!encoder) {
+      api::throw_error(cx, StreamErrors::StreamInitializationFailed, "compression");
+      return nullptr;
+    }
+    JS::SetReservedSlot(stream, CompressionStream::Slots::State, JS::PrivateValue(encoder));
+    if (!BrotliEncoderSetParameter(encoder, BROTLI_PARAM_QUALITY, BROTLI_QUALITY)) {
+      api::throw_error(cx, StreamErrors::StreamInitializationFailed, "compression");
+      return nullptr;
+    }
+    return stream;
+  }
+
+  if (format == Format::Zstd) {
+    ZSTD_CStream *cstream = ZSTD_createCStream();
+    if (!cstream) {
+      api::throw_error(cx, StreamErrors::StreamInitializationFailed, "compression");
+      return nullptr;
+    }
+    JS::SetReservedSlot(stream, CompressionStream::Slots::State, JS::PrivateValue(cstream));
+    if (ZSTD_isError(ZSTD_CCtx_setParameter(cstream, ZSTD_c_compressionLevel, ZSTD_LEVEL))) {
+      api::throw_error(cx, StreamErrors::StreamInitializationFailed, "compression");
+      return nullptr;
+    }
+    return stream;
+  }
+
+  auto *zstream = (z_stream *)JS_malloc(cx, sizeof(z_stream));
+  if (!zstream) {
     JS_ReportOutOfMemory(cx);
     return nullptr;
   }
 
-  JS::SetReservedSlot(stream, CompressionStream::Slots::Buffer, JS::PrivateValue(buffer));
+  memset(zstream, 0, sizeof(z_stream));
+  JS::SetReservedSlot(stream, CompressionStream::Slots::State, JS::PrivateValue(zstream));
 
-  // Using the same window bits as Chromium's Compression stream, see
-  // https://chromium.googlesource.com/chromium/src/+/457f48d3d8635c8bca077232471228d75290cc29/third_party/blink/renderer/modules/compression/deflate_transformer.cc#31
-  int window_bits = 15;
+  int window_bits = params.window_bits;
   if (format == Format::GZIP) {
     window_bits += 16;
   } else if (format == Format::DeflateRaw) {
-    window_bits = -15;
+    window_bits = -window_bits;
   }
 
-  int err =
-      deflateInit2(zstream, COMPRESSION_LEVEL, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+  int err = deflateInit2(zstream, params.level, Z_DEFLATED, window_bits, params.mem_level,
+                         Z_DEFAULT_STRATEGY);
   if (err != Z_OK) {
     api::throw_error(cx, StreamErrors::StreamInitializationFailed, "compression");
     return nullptr;
@@ -275,6 +459,71 @@ JSObject *create(JSContext *cx, JS::HandleObject stream, Format format) {
   return stream;
 }
 
+// Reads the integer option `name` from `options` into `out`, leaving it unchanged if the option
+// isn't present.
+bool read_deflate_option(JSContext *cx, JS::HandleObject options, const char *name, int min,
+                         int max, const char *range, int *out) {
+  JS::RootedValue val(cx);
+  if (!JS_GetProperty(cx, options, name, &val)) {
+    return false;
+  }
+  if (val.isUndefined()) {
+    return true;
+  }
+
+  double num = 0;
+  if (!JS::ToNumber(cx, val, &num)) {
+    return false;
+  }
+  if (!(num >= min && num <= max) || num != static_cast<int>(num)) {
+    return api::throw_error(cx, StreamErrors::InvalidCompressionOption, name, range);
+  }
+
+  *out = static_cast<int>(num);
+  return true;
+}
+
+// Applies the non-standard `level`, `windowBits`, and `memLevel` options to `params`.
+//
+// All options are validated before any of them are applied, so `params` is left unchanged if
+// an exception is thrown.
+bool read_deflate_options(JSContext *cx, const char *method, JS::HandleValue options_val,
+                          DeflateParams *params) {
+  if (options_val.isNullOrUndefined()) {
+    return true;
+  }
+  if (!options_val.isObject()) {
+    return api::throw_error(cx, api::Errors::TypeError, method, "options", "be an object");
+  }
+
+  JS::RootedObject options(cx, &options_val.toObject());
+  DeflateParams result = *params;
+  if (!read_deflate_option(cx, options, "level", 0, 9, "0 to 9", &result.level) ||
+      !read_deflate_option(cx, options, "windowBits", 9, 15, "9 to 15", &result.window_bits) ||
+      !read_deflate_option(cx, options, "memLevel", 1, 9, "1 to 9", &result.mem_level)) {
+    return false;
+  }
+
+  *params = result;
+  return true;
+}
+
+// Sets the parameters used by all subsequently created CompressionStreams that don't override
+// them. Only available to the initializer script.
+bool set_compression_stream_defaults(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  if (!args.requireAtLeast(cx, "setCompressionStreamDefaults", 1)) {
+    return false;
+  }
+
+  if (!read_deflate_options(cx, "setCompressionStreamDefaults", args[0], &DEFAULT_PARAMS)) {
+    return false;
+  }
+
+  args.rval().setUndefined();
+  return true;
+}
+
 } // namespace
 
 /**
@@ -297,13 +546,27 @@ bool CompressionStream::constructor(JSContext *cx, unsigned argc, JS::Value *vp)
     format = Format::Deflate;
   } else if (strcmp(format_chars.begin(), "gzip") == 0) {
     format = Format::GZIP;
+  } else if (strcmp(format_chars.begin(), "br") == 0 ||
+             strcmp(format_chars.begin(), "brotli") == 0) {
+    // Non-standard: "br" is the HTTP content coding name, "brotli" the one proposed for the spec.
+    format = Format::Brotli;
+  } else if (strcmp(format_chars.begin(), "zstd") == 0) {
+    // Non-standard.
+    format = Format::Zstd;
   } else {
     return api::throw_error(cx, StreamErrors::InvalidCompressionFormat, format_chars.begin());
   }
 
+  // Non-standard: if enabled, an options bag can override the default deflate parameters.
+  DeflateParams params = DEFAULT_PARAMS;
+  if (api::Engine::get(cx)->compression_stream_options_enabled() &&
+      !read_deflate_options(cx, "CompressionStream constructor", args.get(1), &params)) {
+    return false;
+  }
+
   JS::RootedObject compressionStreamInstance(cx, JS_NewObjectForConstructor(cx, &class_, args));
   // Steps 2-6.
-  JS::RootedObject stream(cx, create(cx, compressionStreamInstance, format));
+  JS::RootedObject stream(cx, create(cx, compressionStreamInstance, format, params));
   if (!stream) {
     return false;
   }
@@ -329,7 +592,10 @@ bool CompressionStream::init_class(JSContext *cx, JS::HandleObject global) {
   }
   flushAlgo.init(cx, JS_GetFunctionObject(flushFun));
 
-  return true;
+  JS::RootedObject init_global(cx, api::Engine::init_script_global());
+  JSAutoRealm ar(cx, init_global);
+  return JS_DefineFunction(cx, init_global, "setCompressionStreamDefaults",
+                           set_compression_stream_defaults, 1, 0) != nullptr;
 }
 
 } // namespace builtins::web::streams
@@ -13,7 +13,7 @@ namespace builtins::web::streams {
  * All algorithm names and steps refer to spec algorithms defined at
  * https://streams.spec.whatwg.org/#ts-class
  */
-class CompressionStream : public BuiltinImpl<CompressionStream> {
+class CompressionStream : public BuiltinImpl<CompressionStream, FinalizableClassPolicy> {
   static bool transformAlgorithm(JSContext *cx, unsigned argc, JS::Value *vp);
   static bool flushAlgorithm(JSContext *cx, unsigned argc, JS::Value *vp);
   static bool readable_get(JSContext *cx, unsigned argc, JS::Value *vp);
@@ -33,6 +33,7 @@ public:
 
   static bool init_class(JSContext *cx, JS::HandleObject global);
   static bool constructor(JSContext *cx, unsigned argc, JS::Value *vp);
+  static void finalize(JS::GCContext *gcx, JSObject *self);
 };
 
 } // namespace builtins::web::streams
@@ -1,5 +1,7 @@
+#include "brotli/decode.h"
 #include "js/experimental/TypedData.h"
 #include "zlib.h"
+#include "zstd.h"
 
 #include "decompression-stream.h"
 #include "encode.h"
@@ -15,22 +17,37 @@ enum class Format : uint8_t {
   GZIP,
   Deflate,
   DeflateRaw,
+  Brotli,
+  Zstd,
 };
 
 // Using the same fixed encoding buffer size as Chromium, see
 // https://chromium.googlesource.com/chromium/src/+/457f48d3d8635c8bca077232471228d75290cc29/third_party/blink/renderer/modules/compression/deflate_transformer.cc#29
 constexpr size_t BUFFER_SIZE = 16384;
 
+// The largest zstd window accepted, as the base-two logarithm of its size. The decoder allocates
+// the window a frame declares, and by default accepts windows of up to 128MiB. This uses the same
+// 8MiB limit as the zstd HTTP content coding, see https://www.rfc-editor.org/rfc/rfc9659.
+constexpr int ZSTD_WINDOW_LOG_MAX = 23;
+
 JSObject *transform(JSObject *self) {
   MOZ_ASSERT(DecompressionStream::is_instance(self));
   return &JS::GetReservedSlot(self, DecompressionStream::Slots::Transform).toObject();
 }
 
-z_stream *state(JSObject *self) {
+Format format(JSObject *self) {
+  MOZ_ASSERT(DecompressionStream::is_instance(self));
+  return static_cast<Format>(
+      JS::GetReservedSlot(self, DecompressionStream::Slots::Format).toInt32());
+}
+
+// The decompressor state, which is a `z_stream`, `BrotliDecoderState`, or `ZSTD_DStream`
+// depending on the format.
+void *state(JSObject *self) {
   MOZ_ASSERT(DecompressionStream::is_instance(self));
   void *ptr = JS::GetReservedSlot(self, DecompressionStream::Slots::State).toPrivate();
   MOZ_ASSERT(ptr);
-  return (z_stream *)ptr;
+  return ptr;
 }
 
 uint8_t *output_buffer(JSObject *self) {
@@ -43,9 +60,100 @@ uint8_t *output_buffer(JSObject *self) {
 JS::PersistentRooted<JSObject *> transformAlgo;
 JS::PersistentRooted<JSObject *> flushAlgo;
 
+// Runs the decompressor once, consuming as much of the input as it can and filling at most one
+// output buffer.
+//
+// On return, `input` and `avail_in` are advanced past the consumed input, `written` holds the
+// number of bytes written to `buffer`, and `more` is set if the decompressor has to be run again
+// to consume the remaining input, or to produce the remaining output.
+bool decompress_step(JSContext *cx, JSObject *self, const uint8_t **input, size_t *avail_in,
+                     uint8_t *buffer, bool finish, size_t *written, bool *more) {
+  switch (format(self)) {
+  case Format::GZIP:
+  case Format::Deflate:
+  case Format::DeflateRaw: {
+    // See the zlib docs for details on how `inflate` consumes input and produces output:
+    // https://searchfox.org/mozilla-central/rev/87ecd21d3ca517f8d90e49b32bf042a754ed8f18/modules/zlib/src/zlib.h#319-324
+    auto *zstream = static_cast<z_stream *>(state(self));
+    zstream->next_in = const_cast<uint8_t *>(*input);
+    zstream->avail_in = *avail_in;
+    zstream->next_out = buffer;
+    zstream->avail_out = BUFFER_SIZE;
+    int err = inflate(zstream, finish ? Z_FINISH : Z_NO_FLUSH);
+    if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
+      return api::throw_error(cx, StreamErrors::DecompressingChunkFailed);
+    }
+    *input = zstream->next_in;
+    *avail_in = zstream->avail_in;
+    *written = BUFFER_SIZE - zstream->avail_out;
+    *more = zstream->avail_out == 0;
+    return true;
+  }
+  case Format::Brotli: {
+    auto *decoder = static_cast<BrotliDecoderState *>(state(self));
+    size_t avail_out = BUFFER_SIZE;
+    uint8_t *next_out = buffer;
+    auto result =
+        BrotliDecoderDecompressStream(decoder, avail_in, input, &avail_out, &next_out, nullptr);
+    // Data following the end of the compressed stream is an error, as for the other formats.
+    if (result == BROTLI_DECODER_RESULT_ERROR ||
+        (result == BROTLI_DECODER_RESULT_SUCCESS && *avail_in != 0)) {
+      return api::throw_error(cx, StreamErrors::DecompressingChunkFailed);
+    }
+    *written = BUFFER_SIZE - avail_out;
+    *more = result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+    return true;
+  }
+  case Format::Zstd: {
+    auto *dstream = static_cast<ZSTD_DStream *>(state(self));
+    ZSTD_inBuffer in = {*input, *avail_in, 0};
+    ZSTD_outBuffer out = {buffer, BUFFER_SIZE, 0};
+    // The result is 0 once a frame has been fully decoded and flushed.
+    size_t hint = ZSTD_decompressStream(dstream, &out, &in);
+    if (ZSTD_isError(hint)) {
+      return api::throw_error(cx, StreamErrors::DecompressingChunkFailed);
+    }
+    // Calls that make no progress, such as a final one with empty input after a frame ended,
+    // return a hint about the next frame instead.
+    if (in.pos != 0 || out.pos != 0) {
+      JS::SetReservedSlot(self, DecompressionStream::Slots::InputEnded,
+                          JS::BooleanValue(hint == 0));
+    }
+    *input += in.pos;
+    *avail_in -= in.pos;
+    *written = out.pos;
+    *more = *avail_in != 0 || out.pos == out.size;
+    return true;
+  }
+  }
+
+  MOZ_ASSERT_UNREACHABLE("Invalid compression format");
+  return false;
+}
+
+// Whether the end of the compressed input has been reached, i.e. whether it's valid for the
+// input to end here.
+bool input_ended(JSObject *self) {
+  switch (format(self)) {
+  case Format::GZIP:
+  case Format::Deflate:
+  case Format::DeflateRaw:
+    return static_cast<z_stream *>(state(self))->avail_in == 0;
+  case Format::Brotli:
+    return BrotliDecoderIsFinished(static_cast<BrotliDecoderState *>(state(self)));
+  case Format::Zstd:
+    return JS::GetReservedSlot(self, DecompressionStream::Slots::InputEnded).toBoolean();
+  }
+
+  MOZ_ASSERT_UNREACHABLE("Invalid compression format");
+  return false;
+}
+
 // Steps 1-5 of the transform algorithm, and 1-5 of the flush algorithm.
-bool inflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk, bool finished) {
-  z_stream *zstream = state(self);
+bool decompress_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk,
+                      bool finished) {
+  const uint8_t *input = nullptr;
+  size_t avail_in = 0;
 
   if (!finished) {
     // 1.  If _chunk_ is not a `BufferSource` type, then throw a `TypeError`.
@@ -62,12 +170,12 @@ bool inflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk,
     // 2.  Let _buffer_ be the result of decompressing _chunk_ with _ds_'s format
     // and context. This just sets up step 2. The actual decompression happen in
     // the `do` loop below.
-    zstream->avail_in = data->size();
-
+    //
     // `data` is a live view into `chunk`. That's ok here because it'll be fully
     // used in the `do` loop below before any content can execute again and
     // could potentially invalidate the pointer to `data`.
-    zstream->next_in = data->data();
+    input = data->data();
+    avail_in = data->size();
   } else {
     // Step 1 of flush:
     // 1.  Let _buffer_ be the result of decompressing an empty input with _ds_'s
@@ -76,13 +184,11 @@ bool inflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk,
 
     // Step 2 of flush:
     // 2.  If the end of the compressed input has not been reached, then throw a TypeError.
-    if (zstream->avail_in != 0) {
+    if (!input_ended(self)) {
       return api::throw_error(cx, StreamErrors::DecompressingChunkFailed);
     }
     // This just sets up step 3. The actual decompression happens in the `do` loop
     // below.
-    zstream->avail_in = 0;
-    zstream->next_in = nullptr;
   }
 
   JS::RootedObject controller(cx, TransformStream::controller(transform(self)));
@@ -94,25 +200,20 @@ bool inflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk,
 
   uint8_t *buffer = output_buffer(self);
 
-  // Call `inflate` in a loop, enqueuing compressed chunks until the input
-  // buffer has been fully consumed. That is the case when `zstream->avail_out`
-  // is non-zero, i.e. when the last chunk wasn't completely filled. See zlib
-  // docs for details:
-  // https://searchfox.org/mozilla-central/rev/87ecd21d3ca517f8d90e49b32bf042a754ed8f18/modules/zlib/src/zlib.h#319-324
+  // Run the decompressor in a loop, enqueuing decompressed chunks until the
+  // input has been fully consumed and all output it produced has been enqueued.
+  bool more = false;
   do {
     // 4.  Split _buffer_ into one or more non-empty pieces and convert them
     // into `Uint8Array`s.
     // 5.  For each `Uint8Array` _array_, enqueue _array_ in _cds_'s transform.
     // This loop does the actual decompression, one output-buffer sized chunk at a
     // time, and then creates and enqueues the Uint8Arrays immediately.
-    zstream->avail_out = BUFFER_SIZE;
-    zstream->next_out = buffer;
-    int err = inflate(zstream, finished ? Z_FINISH : Z_NO_FLUSH);
-    if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
-
+    size_t bytes = 0;
+    if (!decompress_step(cx, self, &input, &avail_in, buffer, finished, &bytes, &more)) {
+      return false;
     }
 
-    size_t bytes = BUFFER_SIZE - zstream->avail_out;
     if (bytes != 0U) {
       JS::RootedObject out_obj(cx, JS_NewUint8Array(cx, bytes));
       if (!out_obj) {
@@ -133,19 +234,83 @@ bool inflate_chunk(JSContext *cx, JS::HandleObject self, JS::HandleValue chunk,
     }
 
     // 3.  If _buffer_ is empty, return.
-  } while (zstream->avail_out == 0);
+  } while (more);
+
+  return true;
+}
+
+// Frees the decompressor state and output buffer, as far as they have been set up.
+void free_state(JSObject *self) {
+  JS::Value state_val = JS::GetReservedSlot(self, DecompressionStream::Slots::State);
+  if (!state_val.isUndefined() && state_val.toPrivate()) {
+    switch (format(self)) {
+    case Format::GZIP:
+    case Format::Deflate:
+    case Format::DeflateRaw: {
+      auto *zstream = static_cast<z_stream *>(state_val.toPrivate());
+      inflateEnd(zstream);
+      js_free(zstream);
+      break;
+    }
+    case Format::Brotli:
+      BrotliDecoderDestroyInstance(static_cast<BrotliDecoderState *>(state_val.toPrivate()));
+      break;
+    case Format::Zstd:
+      ZSTD_freeDStream(static_cast<ZSTD_DStream *>(state_val.toPrivate()));
+      break;
+    }
+  }
+
+  JS::Value buffer_val = JS::GetReservedSlot(self, DecompressionStream::Slots::Buffer);
+  if (!buffer_val.isUndefined()) {
+    js_free(buffer_val.toPrivate());
+  }
+}
+
+// Releases the decompressor state and output buffer once all output has been flushed.
+void finish_decompression(JSObject *self) {
+  free_state(self);
+  JS::SetReservedSlot(self, DecompressionStream::Slots::State, JS::PrivateValue(nullptr));
+  JS::SetReservedSlot(self, DecompressionStream::Slots::Buffer, JS::PrivateValue(nullptr));
+}
 
+bool finished(JSObject *self) {
+  return JS::GetReservedSlot(self, DecompressionStream::Slots::State).toPrivate() == nullptr;
+}
+
+// Native equivalent of `decompress_chunk`, used for native-to-native pipes: the same steps, but
+// appending the output to `out` instead of enqueuing it as Uint8Arrays.
+bool decompress_bytes(JSContext *cx, JS::HandleObject self, const uint8_t *input, size_t len,
+                      bool finish, std::vector<uint8_t> &out) {
+  uint8_t *buffer = output_buffer(self);
+  bool more = false;
+  do {
+    size_t bytes = 0;
+    if (!decompress_step(cx, self, &input, &len, buffer, finish, &bytes, &more)) {
+      return false;
+    }
+    out.insert(out.end(), buffer, buffer + bytes);
+  } while (more);
+
+  if (finish) {
+    // The final input is passed in along with the finish flag, so unlike for `flushAlgorithm`,
+    // the end of the compressed input can only be checked for after decompressing it.
+    if (!input_ended(self)) {
+      return api::throw_error(cx, StreamErrors::DecompressingChunkFailed);
+    }
+    finish_decompression(self);
+  }
   return true;
 }
 
 } // namespace
 
 // https://wicg.github.io/compression/#decompress-and-enqueue-a-chunk
-// All steps inlined into `inflate_chunk`.
+// All steps inlined into `decompress_chunk`.
 bool DecompressionStream::transformAlgorithm(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER_WITH_NAME(1, "Decompression stream transform algorithm")
 
-  if (!inflate_chunk(cx, self, args[0], false)) {
+  if (!decompress_chunk(cx, self, args[0], false)) {
     return false;
   }
 
@@ -154,28 +319,30 @@ bool DecompressionStream::transformAlgorithm(JSContext *cx, unsigned argc, JS::V
 }
 
 // https://wicg.github.io/compression/#decompress-flush-and-enqueue
-// All steps inlined into `inflate_chunk`.
+// All steps inlined into `decompress_chunk`.
 bool DecompressionStream::flushAlgorithm(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER_WITH_NAME(0, "Decompression stream flush algorithm")
 
-  if (!inflate_chunk(cx, self, JS::UndefinedHandleValue, true)) {
-    return false;
+  // If the input was piped in natively, all output has already been flushed as well.
+  if (finished(self)) {
+    args.rval().setUndefined();
+    return true;
   }
 
-  inflateEnd(state(self));
-  JS_free(cx, output_buffer(self));
+  if (!decompress_chunk(cx, self, JS::UndefinedHandleValue, true)) {
+    return false;
+  }
 
-// These fields shouldn't ever be accessed again, but we should be able to
-// assert that.
-#ifdef DEBUG
-  JS::SetReservedSlot(self, DecompressionStream::Slots::State, JS::PrivateValue(nullptr));
-  JS::SetReservedSlot(self, DecompressionStream::Slots::Buffer, JS::PrivateValue(nullptr));
-#endif
+  finish_decompression(self);
 
   args.rval().setUndefined();
   return true;
 }
 
+// Streams that are errored, cancelled, or dropped before being flushed still hold their
+// decompressor state, which is released here.
+void DecompressionStream::finalize(JS::GCContext *gcx, JSObject *self) { free_state(self); }
+
 bool DecompressionStream::readable_get(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER_WITH_NAME(0, "get readable")
   args.rval().setObject(*TransformStream::readable(transform(self)));
@@ -235,27 +402,53 @@ JSObject *create(JSContext *cx, JS::HandleObject stream, Format format) {
   }
 
   TransformStream::set_used_as_mixin(transform);
+  TransformStream::set_native_transform(transform, stream, decompress_bytes);
   JS::SetReservedSlot(stream, DecompressionStream::Slots::Transform, JS::ObjectValue(*transform));
 
-  // The remainder of the function deals with setting up the inflate state used
-  // for decompressing chunks.
+  JS::SetReservedSlot(stream, DecompressionStream::Slots::InputEnded, JS::FalseValue());
 
-  auto *zstream = (z_stream *)JS_malloc(cx, sizeof(z_stream));
-  if (!zstream) {
+  // The remainder of the function deals with setting up the decompressor state used
+  // for decompressing chunks.
+  auto *buffer = (uint8_t *)JS_malloc(cx, BUFFER_SIZE);
+  if (!buffer) {
     JS_ReportOutOfMemory(cx);
     return nullptr;
   }
 
-  memset(zstream, 0, sizeof(z_stream));
-  JS::SetReservedSlot(stream, DecompressionStream::Slots::State, JS::PrivateValue(zstream));
+  JS::SetReservedSlot(stream, DecompressionStream::Slots::Buffer, JS::PrivateValue(buffer));
 
-  auto *buffer = (uint8_t *)JS_malloc(cx, BUFFER_SIZE);
-  if (!buffer) {
+  if (format == Format::Brotli) {
+    BrotliDecoderState *decoder = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+    if (!decoder) {
+      api::throw_error(cx, StreamErrors::StreamInitializationFailed, "decompression");
+      return nullptr;
+    }
+    JS::SetReservedSlot(stream, DecompressionStream::Slots::State, JS::PrivateValue(decoder));
+    return stream;
+  }
+
+  if (format == Format::Zstd) {
+    ZSTD_DStream *dstream = ZSTD_createDStream();
+    if (!dstream) {
+      api::throw_error(cx, StreamErrors::StreamInitializationFailed, "decompression");
+      return nullptr;
+    }
+    JS::SetReservedSlot(stream, DecompressionStream::Slots::State, JS::PrivateValue(dstream));
+    if (ZSTD_isError(ZSTD_DCtx_setParameter(dstream, ZSTD_d_windowLogMax, ZSTD_WINDOW_LOG_MAX))) {
+      api::throw_error(cx, StreamErrors::StreamInitializationFailed, "decompression");
+      return nullptr;
+    }
+    return stream;
+  }
+
+  auto *zstream = (z_stream *)JS_malloc(cx, sizeof(z_stream));
+  if (!zstream) {
     JS_ReportOutOfMemory(cx);
     return nullptr;
   }
 
-  JS::SetReservedSlot(stream, DecompressionStream::Slots::Buffer, JS::PrivateValue(buffer));
+  memset(zstream, 0, sizeof(z_stream));
+  JS::SetReservedSlot(stream, DecompressionStream::Slots::State, JS::PrivateValue(zstream));
 
   // Using the same window bits as Chromium's Compression stream, see
   // https://chromium.googlesource.com/chromium/src/+/457f48d3d8635c8bca077232471228d75290cc29/third_party/blink/renderer/modules/compression/inflate_transformer.cc#31
@@ -297,9 +490,16 @@ bool DecompressionStream::constructor(JSContext *cx, unsigned argc, JS::Value *v
     format = Format::Deflate;
   } else if (strcmp(format_chars.begin(), "gzip") == 0) {
     format = Format::GZIP;
+  } else if (strcmp(format_chars.begin(), "br") == 0 ||
+             strcmp(format_chars.begin(), "brotli") == 0) {
+    // Non-standard: "br" is the HTTP content coding name, "brotli" the one proposed for the spec.
+    format = Format::Brotli;
+  } else if (strcmp(format_chars.begin(), "zstd") == 0) {
+    // Non-standard.
+    format = Format::Zstd;
   } else {
     return api::throw_error(cx, api::Errors::TypeError, "DecompressionStream constructor",
-                            "format", "be 'deflate', 'deflate-raw', or 'gzip'");
+                            "format", "be 'deflate', 'deflate-raw', 'gzip', 'br', or 'zstd'");
   }
 
   JS::RootedObject decompressionStreamInstance(cx, JS_NewObjectForConstructor(cx, &class_, args));
@@ -13,7 +13,7 @@ namespace builtins::web::streams {
  * All algorithm names and steps refer to spec algorithms defined at
  * https://wicg.github.io/compression/#decompression-stream
  */
-class DecompressionStream : public BuiltinImpl<DecompressionStream> {
+class DecompressionStream : public BuiltinImpl<DecompressionStream, FinalizableClassPolicy> {
   static bool transformAlgorithm(JSContext *cx, unsigned argc, JS::Value *vp);
   static bool flushAlgorithm(JSContext *cx, unsigned argc, JS::Value *vp);
   static bool readable_get(JSContext *cx, unsigned argc, JS::Value *vp);
@@ -22,7 +22,9 @@ class DecompressionStream : public BuiltinImpl<DecompressionStream> {
 public:
   static constexpr const char *class_name = "DecompressionStream";
 
-  enum Slots : uint8_t { Transform, Format, State, Buffer, Count };
+  // `InputEnded` is only maintained for formats whose decoder state doesn't track whether the end
+  // of the compressed input has been reached.
+  enum Slots : uint8_t { Transform, Format, State, Buffer, InputEnded, Count };
 
   static const JSFunctionSpec static_methods[];
   static const JSPropertySpec static_properties[];
@@ -33,6 +35,7 @@ public:
 
   static bool init_class(JSContext *cx, JS::HandleObject global);
   static bool constructor(JSContext *cx, unsigned argc, JS::Value *vp);
+  static void finalize(JS::GCContext *gcx, JSObject *self);
 };
 
 } // namespace builtins::web::streams
@@ -13,8 +13,11 @@ DEF_ERR(PipeThroughToLockedStream, JSEXN_TYPEERR, "The writable end of the trans
                                                   "is already locked", 0)
 DEF_ERR(PipeThroughWrongArg, JSEXN_TYPEERR, "pipeThrough called on a ReadableStream that's already locked", 0)
 DEF_ERR(TransformStreamTerminated, JSEXN_TYPEERR, "The TransformStream has been terminated", 0)
-DEF_ERR(InvalidCompressionFormat, JSEXN_TYPEERR, "'format' has to be \"deflate\",  \"deflate-raw\", or \"gzip\", "
+DEF_ERR(InvalidCompressionFormat, JSEXN_TYPEERR, "'format' has to be \"deflate\", \"deflate-raw\", \"gzip\", "
+                                                 "\"br\", or \"zstd\", "
                                                  "but got \"{0}\"", 1)
+DEF_ERR(InvalidCompressionOption, JSEXN_RANGEERR, "CompressionStream option '{0}' must be an integer "
+                                                  "from {1}", 2)
 };     // namespace StreamErrors
 
 #endif // STREAM_ERRORS_H
@@ -307,12 +307,13 @@ bool TransformStream::readable_used_as_body(JSObject *self) {
  * This allows us to later on short-cut piping from native body to native body.
  *
  * Asserts that |readable| is the readable end of a TransformStream, and that
- * that TransformStream is not used as a mixin by another builtin.
+ * that TransformStream is either not used as a mixin by another builtin, or
+ * has a native transform registered by it.
  */
 void TransformStream::set_readable_used_as_body(JSContext *cx, JS::HandleObject readable,
                                                 JS::HandleObject target) {
   JS::RootedObject ts(cx, ts_from_readable(cx, readable));
-  MOZ_ASSERT(!used_as_mixin(ts));
+  MOZ_ASSERT(!used_as_mixin(ts) || native_transformer(ts));
   set_owner(ts, target);
 }
 
@@ -368,6 +369,35 @@ void TransformStream::set_used_as_mixin(JSObject *self) {
   JS::SetReservedSlot(self, TransformStream::Slots::UsedAsMixin, JS::TrueValue());
 }
 
+JSObject *TransformStream::native_transformer(JSObject *self) {
+  MOZ_ASSERT(is_instance(self));
+  JS::Value val = JS::GetReservedSlot(self, TransformStream::Slots::NativeTransformer);
+  return val.isObject() ? &val.toObject() : nullptr;
+}
+
+TransformStream::NativeTransformAlgorithmImpl
+TransformStream::native_transform_algorithm(JSObject *self) {
+  MOZ_ASSERT(native_transformer(self));
+  return reinterpret_cast<NativeTransformAlgorithmImpl>(
+      JS::GetReservedSlot(self, TransformStream::Slots::NativeTransformAlgorithm).toPrivate());
+}
+
+/**
+ * Registers a native implementation of the transform applied by |transformer|, which must be
+ * the builtin using |self| as a mixin.
+ *
+ * This allows piping a native body through |self| into another native body without creating a JS
+ * chunk or running a promise reaction per chunk.
+ */
+void TransformStream::set_native_transform(JSObject *self, JSObject *transformer,
+                                           NativeTransformAlgorithmImpl algorithm) {
+  MOZ_ASSERT(used_as_mixin(self));
+  JS::SetReservedSlot(self, TransformStream::Slots::NativeTransformer,
+                      JS::ObjectValue(*transformer));
+  JS::SetReservedSlot(self, TransformStream::Slots::NativeTransformAlgorithm,
+                      JS::PrivateValue(reinterpret_cast<void *>(algorithm)));
+}
+
 bool TransformStream::readable_get(JSContext *cx, unsigned argc, JS::Value *vp) {
   METHOD_HEADER_WITH_NAME(0, "get readable")
   auto *readable_val = readable(self);
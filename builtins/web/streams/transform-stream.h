@@ -25,8 +25,20 @@ public:
     UsedAsMixin, // `true` if the TransformStream is used in another transforming
                  // builtin, such as CompressionStream.
     HasTransformer,
+    NativeTransformer, // The builtin, e.g. a CompressionStream, whose transform can be applied
+                       // natively, bypassing the JS machinery for native-to-native pipes.
+    NativeTransformAlgorithm,
     Count
   };
+
+  /// Transforms `len` bytes of `input` without involving JS, appending the result to `out`.
+  /// If `finish` is true, `input` is empty and all remaining output is flushed, after which the
+  /// transformer can't be used again, not even by its JS flush algorithm.
+  ///
+  /// Throws and returns `false` if the input can't be transformed.
+  using NativeTransformAlgorithmImpl = bool (*)(JSContext *cx, JS::HandleObject transformer,
+                                                const uint8_t *input, size_t len, bool finish,
+                                                std::vector<uint8_t> &out);
   static const JSFunctionSpec static_methods[];
   static const JSPropertySpec static_properties[];
   static const JSFunctionSpec methods[];
@@ -48,6 +60,10 @@ public:
   static JSObject *backpressureChangePromise(JSObject *self);
   static bool used_as_mixin(JSObject *self);
   static void set_used_as_mixin(JSObject *self);
+  static JSObject *native_transformer(JSObject *self);
+  static NativeTransformAlgorithmImpl native_transform_algorithm(JSObject *self);
+  static void set_native_transform(JSObject *self, JSObject *transformer,
+                                   NativeTransformAlgorithmImpl algorithm);
   static bool readable_get(JSContext *cx, unsigned argc, JS::Value *vp);
   static bool writable_get(JSContext *cx, unsigned argc, JS::Value *vp);
   static bool constructor(JSContext *cx, unsigned argc, JS::Value *vp);
@@ -28,17 +28,19 @@ bool TextEncoder::encode(JSContext *cx, unsigned argc, JS::Value *vp) {
   }
 
   auto chars = core::encode(cx, args[0]);
+  size_t len = chars.len;
+  auto data = chars.release();
   JS::RootedObject buffer(
-      cx, JS::NewArrayBufferWithContents(cx, chars.len, chars.begin(),
+      cx, JS::NewArrayBufferWithContents(cx, len, data.get(),
                                          JS::NewArrayBufferOutOfMemory::CallerMustFreeMemory));
   if (!buffer) {
     return false;
   }
 
-  // `buffer` now owns `chars`
-  static_cast<void>(chars.ptr.release());
+  // `buffer` now owns `data`
+  static_cast<void>(data.release());
 
-  JS::RootedObject byte_array(cx, JS_NewUint8ArrayWithBuffer(cx, buffer, 0, chars.len));
+  JS::RootedObject byte_array(cx, JS_NewUint8ArrayWithBuffer(cx, buffer, 0, len));
   if (!byte_array) {
     return false;
   }
@@ -7,7 +7,7 @@
 #include <host_api.h>
 #include <iostream>
 #include <list>
-#include <map>
+#include <unordered_map>
 #include <vector>
 
 #define S_TO_NS(s) ((s) * 1000000000)
@@ -17,7 +17,7 @@ namespace {
 
 class TimersMap {
 public:
-  std::map<int32_t, api::AsyncTask *> timers_;
+  std::unordered_map<int32_t, api::AsyncTask *> timers_;
   int32_t next_timer_id = 1;
   void trace(JSTracer *trc) {
     for (auto &[id, timer] : timers_) {
@@ -31,6 +31,12 @@ public:
 static PersistentRooted<js::UniquePtr<TimersMap>> TIMERS_MAP;
 static api::Engine *ENGINE;
 
+/**
+ * A task for a `setTimeout` or `setInterval` timer.
+ *
+ * Timers don't subscribe to a clock pollable of their own: the event loop keeps all tasks with a
+ * deadline in a min-heap, and only subscribes to the host clock for the earliest one.
+ */
 class TimerTask final : public api::AsyncTask {
   using TimerArgumentsVector = std::vector<JS::Heap<JS::Value>>;
 
@@ -46,15 +52,11 @@ public:
   explicit TimerTask(const int64_t delay_ns, const bool repeat, HandleObject callback,
                      JS::HandleValueVector args)
       : timer_id_(TIMERS_MAP->next_timer_id++), delay_(delay_ns), deadline_(host_api::MonotonicClock::now() + delay_ns), repeat_(repeat), callback_(callback) {
-    
-
     arguments_.reserve(args.length());
     for (const auto &arg : args) {
       arguments_.emplace_back(arg);
     }
 
-    handle_ = host_api::MonotonicClock::subscribe(deadline_, true);
-    
     TIMERS_MAP->timers_.emplace(timer_id_, this);
   }
 
@@ -78,14 +80,9 @@ public:
     }
 
     // The task might've been canceled during the callback.
-    if (handle_ != INVALID_POLLABLE_HANDLE) {
-      host_api::MonotonicClock::unsubscribe(handle_);
-    }
-
     if (TIMERS_MAP->timers_.contains(timer_id_)) {
       if (repeat_) {
         deadline_ = host_api::MonotonicClock::now() + delay_;
-        handle_ = host_api::MonotonicClock::subscribe(deadline_, true);
         engine->queue_async_task(this);
       } else {
         TIMERS_MAP->timers_.erase(timer_id_);
@@ -96,19 +93,15 @@ public:
   }
 
   [[nodiscard]] bool cancel(api::Engine *engine) override {
-    if (!TIMERS_MAP->timers_.contains(timer_id_)) {
-      return false;
-    }
-
-    host_api::MonotonicClock::unsubscribe(id());
-    handle_ = -1;
-    return true;
+    return TIMERS_MAP->timers_.contains(timer_id_);
   }
 
   [[nodiscard]] uint64_t deadline() override { return deadline_; }
 
   [[nodiscard]] int32_t timer_id() const { return timer_id_; }
 
+  [[nodiscard]] const char *name() const override { return "TimerTask"; }
+
   void trace(JSTracer *trc) override {
     TraceEdge(trc, &callback_, "Timer callback");
     for (auto &arg : arguments_) {
@@ -117,12 +110,13 @@ public:
   }
 
   static bool clear(int32_t timer_id) {
-    if (!TIMERS_MAP->timers_.contains(timer_id)) {
+    auto it = TIMERS_MAP->timers_.find(timer_id);
+    if (it == TIMERS_MAP->timers_.end()) {
       return false;
     }
 
-    ENGINE->cancel_async_task(TIMERS_MAP->timers_[timer_id]);
-    TIMERS_MAP->timers_.erase(timer_id);
+    ENGINE->cancel_async_task(it->second);
+    TIMERS_MAP->timers_.erase(it);
     return true;
   }
 };
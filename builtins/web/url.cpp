@@ -611,7 +611,7 @@ bool URL::createObjectURL(JSContext *cx, unsigned argc, JS::Value *vp) {
     }
 
     auto chars = core::encode(cx, origin_str);
-    result.append(chars.ptr.get());
+    result.append(chars.data());
   }
 
   // 7. Append U+0024 SOLIDUS (/) to result.
@@ -651,13 +651,13 @@ bool URL::revokeObjectURL(JSContext *cx, unsigned argc, JS::Value *vp) {
   // The revokeObjectURL(url) static method must run these steps:
   // 1. Let urlRecord be the result of parsing url.
   auto chars = core::encode(cx, args.get(0));
-  if (!chars.ptr) {
+  if (!chars) {
     return false;
   }
 
   // 2. If urlRecord’s scheme is not "blob", return.
   // 3. Let entry be urlRecord’s blob URL entry.
-  std::string url_record(chars.ptr.get());
+  std::string url_record(chars.data());
   if (!url_record.starts_with("blob:")) {
     return true;
   }
@@ -0,0 +1,19 @@
+set(BROTLI_VERSION 1.1.0)
+
+CPMAddPackage(NAME brotli
+        GITHUB_REPOSITORY google/brotli
+        GIT_TAG v${BROTLI_VERSION}
+        DOWNLOAD_ONLY TRUE
+)
+
+# Brotli's own build also builds the command line tool, which doesn't support WASI. The library
+# itself is plain C without any platform dependencies, so it's easiest to build it directly.
+file(GLOB BROTLI_SOURCES
+        ${brotli_SOURCE_DIR}/c/common/*.c
+        ${brotli_SOURCE_DIR}/c/dec/*.c
+        ${brotli_SOURCE_DIR}/c/enc/*.c
+)
+add_library(brotli STATIC ${BROTLI_SOURCES})
+target_include_directories(brotli PUBLIC ${brotli_SOURCE_DIR}/c/include)
+# Third-party code isn't held to our warning flags.
+target_compile_options(brotli PRIVATE -w)
@@ -91,6 +91,9 @@ add_builtin(
         builtins/web/streams/streams.cpp
         builtins/web/streams/transform-stream.cpp
         builtins/web/streams/transform-stream-default-controller.cpp
+    DEPENDENCIES
+        brotli
+        zstd
     INCLUDE_DIRS
         runtime)
 
@@ -99,6 +102,8 @@ add_builtin(
     SRC
         builtins/web/fetch/fetch-api.cpp
         builtins/web/fetch/fetch-utils.cpp
+        builtins/web/fetch/header-names.cpp
+        builtins/web/fetch/header-scan.cpp
         builtins/web/fetch/headers.cpp
         builtins/web/fetch/request-response.cpp
     DEPENDENCIES
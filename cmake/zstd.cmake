@@ -0,0 +1,20 @@
+set(ZSTD_VERSION 1.5.6)
+
+CPMAddPackage(NAME zstd
+        GITHUB_REPOSITORY facebook/zstd
+        GIT_TAG v${ZSTD_VERSION}
+        DOWNLOAD_ONLY TRUE
+)
+
+# Only the single-threaded streaming (de)compression API is used, so the library is built directly
+# from its sources, without the dictionary builder, legacy format support, or the x86 assembly.
+file(GLOB ZSTD_SOURCES
+        ${zstd_SOURCE_DIR}/lib/common/*.c
+        ${zstd_SOURCE_DIR}/lib/compress/*.c
+        ${zstd_SOURCE_DIR}/lib/decompress/*.c
+)
+add_library(zstd STATIC ${ZSTD_SOURCES})
+target_include_directories(zstd PUBLIC ${zstd_SOURCE_DIR}/lib)
+target_compile_definitions(zstd PRIVATE ZSTD_DISABLE_ASM ZSTD_LEGACY_SUPPORT=0)
+# Third-party code isn't held to our warning flags.
+target_compile_options(zstd PRIVATE -w)
@@ -233,6 +233,8 @@ public:
 class OutgoingBodyHandle final : public WASIHandle<host_api::HttpOutgoingBody> {
   HandleOps<OutputStream>::owned stream_handle_;
   PollableHandle pollable_handle_;
+  // The task writing chunks queued with `HttpOutgoingBody::write_all`, created on first use.
+  RefPtr<api::AsyncTask> writer_;
 
   friend host_api::HttpOutgoingBody;
 
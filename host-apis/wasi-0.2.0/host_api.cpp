@@ -2,44 +2,39 @@
 #include "bindings/bindings.h"
 #include "handles.h"
 
+#include <deque>
+
 static std::optional<wasi_clocks_monotonic_clock_own_pollable_t> immediately_ready;
 
-size_t poll_handles(vector<WASIHandle<host_api::Pollable>::Borrowed> handles) {
-  auto list = list_borrow_pollable_t{handles.data(), handles.size()};
+// The event loop's pollable set is handed to the host as-is, without building a list of borrows.
+static_assert(sizeof(PollableHandle) == sizeof(borrow_pollable_t));
+
+void api::AsyncTask::select(std::vector<PollableHandle> &pollables, std::vector<uint32_t> &ready,
+                            bool block) {
+  const size_t count = pollables.size();
+  if (!block) {
+    if (!immediately_ready) {
+      immediately_ready = wasi_clocks_monotonic_clock_subscribe_duration(0);
+    }
+    pollables.push_back(immediately_ready.value().__handle);
+  }
+
+  auto list = list_borrow_pollable_t{reinterpret_cast<borrow_pollable_t *>(pollables.data()),
+                                     pollables.size()};
   bindings_list_u32_t result{nullptr, 0};
   wasi_io_poll_poll(&list, &result);
   MOZ_ASSERT(result.len > 0);
-  const auto ready_index = result.ptr[0];
-  free(result.ptr);
-  return ready_index;
-}
-
-size_t api::AsyncTask::select(std::vector<RefPtr<AsyncTask>> &tasks) {
-  auto count = tasks.size();
-  std::vector<WASIHandle<host_api::Pollable>::Borrowed> handles;
-
-  for (size_t idx = 0; idx < count; ++idx) {
-    auto task = tasks.at(idx);
-    auto id = task->id();
-
-    if (id == IMMEDIATE_TASK_HANDLE) {
-      if (handles.size() > 0) {
-        if (!immediately_ready) {
-          immediately_ready = wasi_clocks_monotonic_clock_subscribe_duration(0);
-        }
-        handles.emplace_back(immediately_ready.value().__handle);
-        size_t len = handles.size();
-        size_t ready_index = poll_handles(std::move(handles));
-        if (ready_index <= len - 1) {
-          return ready_index;
-        }
-      }
-      return idx;
+  for (size_t i = 0; i < result.len; i++) {
+    // Skip the `immediately_ready` pollable, which is only used to make the poll non-blocking.
+    if (result.ptr[i] < count) {
+      ready.push_back(result.ptr[i]);
     }
-    handles.emplace_back(id);
   }
+  free(result.ptr);
 
-  return poll_handles(std::move(handles));
+  if (!block) {
+    pollables.pop_back();
+  }
 }
 
 namespace host_api {
@@ -61,6 +56,13 @@ template <typename T> T from_string_view(std::string_view str) {
 
 auto string_view_to_world_string = from_string_view<bindings_string_t>;
 
+// Free memory allocated by a host call, which may have come from the `RequestArena`.
+void free_host_allocation(void *ptr) {
+  if (!RequestArena::release(ptr)) {
+    free(ptr);
+  }
+}
+
 HostString scheme_to_string(const wasi_http_types_scheme_t &scheme) {
   if (scheme.tag == WASI_HTTP_TYPES_SCHEME_HTTP) {
     return {"http"};
@@ -195,16 +197,20 @@ Result<vector<tuple<HostString, HostString>>> HttpHeadersReadOnly::entries() con
 
   bindings_list_tuple2_field_key_field_value_t entries;
   Borrow<HttpHeaders> borrow(this->handle_state_.get());
-  wasi_http_types_method_fields_entries(borrow, &entries);
+  {
+    RequestArena::Scope arena_scope;
+    wasi_http_types_method_fields_entries(borrow, &entries);
+  }
 
   vector<tuple<HostString, HostString>> entries_vec;
+  entries_vec.reserve(entries.len);
   for (int i = 0; i < entries.len; i++) {
     auto key = entries.ptr[i].f0;
     auto value = entries.ptr[i].f1;
     entries_vec.emplace_back(to_host_string(key), to_host_string(value));
   }
   // Free the outer list, but not the entries themselves.
-  free(entries.ptr);
+  free_host_allocation(entries.ptr);
   res.emplace(std::move(entries_vec));
 
   return res;
@@ -215,7 +221,10 @@ Result<vector<HostString>> HttpHeadersReadOnly::names() const {
 
   bindings_list_tuple2_field_key_field_value_t entries;
   Borrow<HttpHeaders> borrow(this->handle_state_.get());
-  wasi_http_types_method_fields_entries(borrow, &entries);
+  {
+    RequestArena::Scope arena_scope;
+    wasi_http_types_method_fields_entries(borrow, &entries);
+  }
 
   vector<HostString> names;
   names.reserve(entries.len);
@@ -223,7 +232,7 @@ Result<vector<HostString>> HttpHeadersReadOnly::names() const {
     names.emplace_back(bindings_string_to_host_string(entries.ptr[i].f0));
   }
   // Free the outer list, but not the entries themselves.
-  free(entries.ptr);
+  free_host_allocation(entries.ptr);
   res.emplace(std::move(names));
 
   return res;
@@ -235,7 +244,10 @@ Result<optional<vector<HostString>>> HttpHeadersReadOnly::get(string_view name)
   bindings_list_field_value_t values;
   auto hdr = string_view_to_world_string(name);
   Borrow<HttpHeaders> borrow(this->handle_state_.get());
-  wasi_http_types_method_fields_get(borrow, &hdr, &values);
+  {
+    RequestArena::Scope arena_scope;
+    wasi_http_types_method_fields_get(borrow, &hdr, &values);
+  }
 
   if (values.len > 0) {
     std::vector<HostString> names;
@@ -244,7 +256,7 @@ Result<optional<vector<HostString>>> HttpHeadersReadOnly::get(string_view name)
       names.emplace_back(to_host_string<field_value>(values.ptr[i]));
     }
     // Free the outer list, but not the values themselves.
-    free(values.ptr);
+    free_host_allocation(values.ptr);
     res.emplace(std::move(names));
   } else {
     res.emplace(std::nullopt);
@@ -318,6 +330,7 @@ string_view HttpRequestResponseBase::url() {
 
   Borrow<HttpIncomingRequest> borrow(handle_state_.get());
 
+  RequestArena::Scope arena_scope;
   wasi_http_types_scheme_t scheme;
   bool success;
   success = wasi_http_types_method_incoming_request_scheme(borrow, &scheme);
@@ -332,7 +345,7 @@ string_view HttpRequestResponseBase::url() {
   MOZ_RELEASE_ASSERT(success);
 
   HostString scheme_str = scheme_to_string(scheme);
-  _url = new std::string(scheme_str.ptr.release(), scheme_str.len);
+  _url = new std::string(string_view(scheme_str));
   _url->append("://");
   _url->append(string_view(bindings_string_to_host_string(authority)));
   _url->append(string_view(bindings_string_to_host_string(path)));
@@ -374,6 +387,33 @@ Result<uint64_t> HttpOutgoingBody::capacity() {
   return Result<uint64_t>::ok(capacity);
 }
 
+Result<uint64_t> HttpOutgoingBody::splice(HttpIncomingBody *source, uint64_t len, bool *done) {
+  *done = false;
+  auto *state = static_cast<OutgoingBodyHandle *>(this->handle_state_.get());
+  auto *source_state = IncomingBodyHandle::cast(source->handle_state_.get());
+  Borrow<OutputStream> borrow(state->stream_handle_);
+  Borrow<InputStream> source_borrow(source_state->stream_handle_);
+
+  uint64_t spliced = 0;
+  wasi_io_streams_stream_error_t err;
+  if (!wasi_io_streams_method_output_stream_splice(borrow, source_borrow, len, &spliced, &err)) {
+    if (err.tag == WASI_IO_STREAMS_STREAM_ERROR_CLOSED) {
+      // `splice` reports `closed` both if `source` has reached its end and if this stream has
+      // been closed. Only the former means that the append is done, so check which one it is.
+      uint64_t capacity = 0;
+      wasi_io_streams_stream_error_t write_err;
+      if (wasi_io_streams_method_output_stream_check_write(borrow, &capacity, &write_err)) {
+        *done = true;
+        return Result<uint64_t>::ok(0);
+      }
+      err = write_err;
+    }
+    dump_io_error(err);
+    return Result<uint64_t>::err(154);
+  }
+  return Result<uint64_t>::ok(spliced);
+}
+
 void HttpOutgoingBody::write(const uint8_t *bytes, size_t len) {
   MOZ_ASSERT(capacity().unwrap() >= len);
 
@@ -382,54 +422,192 @@ void HttpOutgoingBody::write(const uint8_t *bytes, size_t len) {
   MOZ_RELEASE_ASSERT(write_to_outgoing_body(borrow, bytes, len));
 }
 
+/**
+ * Writes the chunks queued using `HttpOutgoingBody::write_all` to the body's output stream.
+ *
+ * Each body has at most one of these tasks, which stays alive for the body's lifetime and is
+ * queued whenever there are chunks left to write. Chunks are written in as few host calls as
+ * the stream's capacity allows: a chunk that fills the available capacity on its own is written
+ * straight from its buffer, while runs of smaller chunks are coalesced into a single write.
+ */
 class BodyWriteAllTask final : public api::AsyncTask {
+  // Up to this many bytes can be buffered before callers of `write_all` have to wait.
+  static constexpr size_t HIGH_WATER_MARK = 64 * 1024;
+
+  api::Engine *engine_;
   HttpOutgoingBody *outgoing_body_;
   PollableHandle outgoing_pollable_;
 
-  api::TaskCompletionCallback cb_;
-  Heap<JSObject *> cb_receiver_;
-  HostBytes bytes_;
+  std::deque<HostBytes> chunks_;
+  // The number of bytes of the first chunk that have already been written.
   size_t offset_ = 0;
+  size_t buffered_ = 0;
+  std::vector<uint8_t> coalesce_buffer_;
+  bool queued_ = false;
+
+  // A callback waiting for the buffered data to drain, and the number of bytes at which to run it.
+  api::TaskCompletionCallback cb_ = nullptr;
+  Heap<JSObject *> cb_receiver_;
+  size_t cb_threshold_ = 0;
+
+  // Tasks writing to the body directly, which may only start once all buffered data is written.
+  std::vector<RefPtr<api::AsyncTask>> deferred_;
+
+  void queue_deferred() {
+    for (auto &task : deferred_) {
+      engine_->queue_async_task(task);
+    }
+    deferred_.clear();
+  }
+
+  void write_some(uint64_t capacity) {
+    auto &first = chunks_.front();
+    size_t first_len = first.len - offset_;
+    if (chunks_.size() == 1 || first_len >= capacity) {
+      size_t len = std::min(first_len, static_cast<size_t>(capacity));
+      outgoing_body_->write(first.ptr.get() + offset_, len);
+      consume(len);
+      return;
+    }
+
+    coalesce_buffer_.clear();
+    for (auto it = chunks_.begin(); it != chunks_.end() && coalesce_buffer_.size() < capacity;
+         ++it) {
+      size_t start = it == chunks_.begin() ? offset_ : 0;
+      size_t len = std::min(it->len - start, static_cast<size_t>(capacity) - coalesce_buffer_.size());
+      coalesce_buffer_.insert(coalesce_buffer_.end(), it->ptr.get() + start,
+                              it->ptr.get() + start + len);
+    }
+    outgoing_body_->write(coalesce_buffer_.data(), coalesce_buffer_.size());
+    consume(coalesce_buffer_.size());
+  }
+
+  void consume(size_t len) {
+    buffered_ -= len;
+    while (len > 0) {
+      size_t first_len = chunks_.front().len - offset_;
+      if (len < first_len) {
+        offset_ += len;
+        return;
+      }
+      len -= first_len;
+      offset_ = 0;
+      chunks_.pop_front();
+    }
+  }
+
+  bool maybe_run_callback() {
+    if (!cb_ || buffered_ > cb_threshold_) {
+      return true;
+    }
+    auto cb = cb_;
+    cb_ = nullptr;
+    RootedObject receiver(engine_->cx(), cb_receiver_);
+    cb_receiver_ = nullptr;
+    return cb(engine_->cx(), receiver);
+  }
+
+  /// Wait for `buffered_` to drop to at most `threshold` bytes before running `callback`.
+  ///
+  /// Returns `true` if that's already the case, in which case the callback isn't stored.
+  bool set_callback(size_t threshold, api::TaskCompletionCallback callback,
+                    HandleObject receiver) {
+    if (buffered_ <= threshold) {
+      return true;
+    }
+    MOZ_ASSERT(!cb_, "Only one write can wait for the body to drain at a time");
+    cb_ = callback;
+    cb_receiver_ = receiver;
+    cb_threshold_ = threshold;
+    return false;
+  }
 
 public:
-  explicit BodyWriteAllTask(HttpOutgoingBody *outgoing_body, HostBytes bytes,
-                          api::TaskCompletionCallback completion_callback,
-                          HandleObject callback_receiver)
-      : outgoing_body_(outgoing_body), cb_(completion_callback),
-        cb_receiver_(callback_receiver), bytes_(std::move(bytes)) {
+  explicit BodyWriteAllTask(api::Engine *engine, HttpOutgoingBody *outgoing_body)
+      : engine_(engine), outgoing_body_(outgoing_body) {
     outgoing_pollable_ = outgoing_body_->subscribe().unwrap();
   }
 
+  bool push(HostBytes bytes, api::TaskCompletionCallback callback, HandleObject receiver) {
+    buffered_ += bytes.len;
+    chunks_.push_back(std::move(bytes));
+    if (!queued_) {
+      queued_ = true;
+      engine_->queue_async_task(this);
+    }
+    return set_callback(HIGH_WATER_MARK - 1, callback, receiver);
+  }
+
+  bool flush(api::TaskCompletionCallback callback, HandleObject receiver) {
+    return set_callback(0, callback, receiver);
+  }
+
+  /// Queue `task` once all buffered chunks are written, or right away if there aren't any.
+  void queue_after_writes(api::AsyncTask *task) {
+    if (chunks_.empty()) {
+      engine_->queue_async_task(task);
+      return;
+    }
+    deferred_.emplace_back(task);
+  }
+
+  /// Synchronously write all buffered chunks, and dequeue the task.
+  ///
+  /// Used when the body is closed without waiting for the writes to complete.
+  void drain_blocking() {
+    if (queued_) {
+      engine_->cancel_async_task(this);
+      queued_ = false;
+    }
+    while (!chunks_.empty()) {
+      auto res = outgoing_body_->capacity();
+      if (res.is_err()) {
+        break;
+      }
+      if (res.unwrap() == 0) {
+        wasi_io_poll_method_pollable_block({outgoing_pollable_});
+        continue;
+      }
+      write_some(res.unwrap());
+    }
+    chunks_.clear();
+    buffered_ = 0;
+    cb_ = nullptr;
+    cb_receiver_ = nullptr;
+
+    // Tasks waiting for the writes can't write to the body anymore once it's closed, so they're
+    // cancelled instead, which lets them settle the streams they were going to pipe.
+    auto deferred = std::move(deferred_);
+    for (auto &task : deferred) {
+      task->cancel(engine_);
+    }
+  }
+
   [[nodiscard]] bool run(api::Engine *engine) override {
-    MOZ_ASSERT(offset_ < bytes_.len);
-    while (true) {
+    MOZ_ASSERT(!chunks_.empty());
+    queued_ = false;
+    while (!chunks_.empty()) {
       auto res = outgoing_body_->capacity();
       if (res.is_err()) {
         return false;
       }
       uint64_t capacity = res.unwrap();
       if (capacity == 0) {
-        engine->queue_async_task(this);
-        return true;
+        break;
       }
+      write_some(capacity);
+    }
 
-      auto bytes_to_write = std::min(bytes_.len - offset_, static_cast<size_t>(capacity));
-      outgoing_body_->write(bytes_.ptr.get() + offset_, bytes_to_write);
-      offset_ += bytes_to_write;
-      MOZ_ASSERT(offset_ <= bytes_.len);
-      if (offset_ == bytes_.len) {
-        bytes_.ptr.reset();
-        RootedObject receiver(engine->cx(), cb_receiver_);
-        bool result = cb_(engine->cx(), receiver);
-        cb_ = nullptr;
-        cb_receiver_ = nullptr;
-        return result;
-      }
+    if (!chunks_.empty()) {
+      queued_ = true;
+      engine->queue_async_task(this);
+    } else {
+      queue_deferred();
     }
+    return maybe_run_callback();
   }
 
   [[nodiscard]] bool cancel(api::Engine *engine) override {
-    MOZ_ASSERT_UNREACHABLE("BodyWriteAllTask's semantics don't allow for cancellation");
     return true;
   }
 
@@ -437,27 +615,75 @@ public:
     return outgoing_pollable_;
   }
 
+  [[nodiscard]] const char *name() const override { return "BodyWriteAllTask"; }
+
   void trace(JSTracer *trc) override {
     JS::TraceEdge(trc, &cb_receiver_, "BodyWriteAllTask completion callback receiver");
+    // Deferred tasks aren't queued, so the event loop doesn't trace them.
+    for (auto &task : deferred_) {
+      task->trace(trc);
+    }
   }
 };
 
-Result<Void> HttpOutgoingBody::write_all(api::Engine *engine, HostBytes bytes,
-  api::TaskCompletionCallback callback, HandleObject cb_receiver) {
+static BodyWriteAllTask *body_writer(api::Engine *engine, HttpOutgoingBody *body,
+                                     OutgoingBodyHandle *state) {
+  if (!state->writer_) {
+    state->writer_ = new BodyWriteAllTask(engine, body);
+  }
+  return static_cast<BodyWriteAllTask *>(state->writer_.get());
+}
+
+Result<bool> HttpOutgoingBody::write_all(api::Engine *engine, HostBytes bytes,
+                                         api::TaskCompletionCallback callback,
+                                         HandleObject cb_receiver) {
   if (!valid()) {
     // TODO: proper error handling for all 154 error codes.
-    return Result<Void>::err(154);
+    return Result<bool>::err(154);
   }
-  engine->queue_async_task(new BodyWriteAllTask(this, std::move(bytes), callback, cb_receiver));
-  return {};
+  auto *state = static_cast<OutgoingBodyHandle *>(handle_state_.get());
+  auto *writer = body_writer(engine, this, state);
+  return Result<bool>::ok(writer->push(std::move(bytes), callback, cb_receiver));
 }
 
+Result<bool> HttpOutgoingBody::flush(api::Engine *engine, api::TaskCompletionCallback callback,
+                                     HandleObject cb_receiver) {
+  if (!valid()) {
+    // TODO: proper error handling for all 154 error codes.
+    return Result<bool>::err(154);
+  }
+  auto *state = static_cast<OutgoingBodyHandle *>(handle_state_.get());
+  if (!state->writer_) {
+    return Result<bool>::ok(true);
+  }
+  return Result<bool>::ok(body_writer(engine, this, state)->flush(callback, cb_receiver));
+}
+
+void HttpOutgoingBody::queue_after_writes(api::Engine *engine, api::AsyncTask *task) {
+  auto *state = static_cast<OutgoingBodyHandle *>(handle_state_.get());
+  if (!state->writer_) {
+    engine->queue_async_task(task);
+    return;
+  }
+  body_writer(engine, this, state)->queue_after_writes(task);
+}
+
+/**
+ * Appends an incoming body to an outgoing body, entirely on the host side.
+ *
+ * Data is moved using `splice`, so it never passes through guest memory: each splice moves as much
+ * as the outgoing stream's current write budget allows straight from the incoming stream. That
+ * makes forwarding a large body cost a handful of host calls per write budget, instead of a
+ * `check-write`, a `read`, and a `write` for every chunk.
+ */
 class BodyAppendTask final : public api::AsyncTask {
+  // The maximum number of bytes to move with a single splice. The host additionally limits this
+  // to the outgoing stream's write budget.
+  static constexpr uint64_t MAX_SPLICE_SIZE = 1024 * 1024;
+
   enum class State : uint8_t {
-    BlockedOnBoth,
     BlockedOnIncoming,
     BlockedOnOutgoing,
-    Ready,
     Done,
   };
 
@@ -487,91 +713,57 @@ public:
                           api::TaskCompletionCallback completion_callback,
                           HandleObject callback_receiver)
       : incoming_body_(incoming_body), outgoing_body_(outgoing_body), cb_(completion_callback),
-        cb_receiver_(callback_receiver), state_(State::BlockedOnBoth) {
+        cb_receiver_(callback_receiver), state_(State::BlockedOnIncoming) {
     incoming_pollable_ = incoming_body_->subscribe().unwrap();
     outgoing_pollable_ = outgoing_body_->subscribe().unwrap();
   }
 
   [[nodiscard]] bool run(api::Engine *engine) override {
-    // If run is called while we're blocked on the incoming stream, that means that stream's
-    // pollable has resolved, so the stream must be ready.
-    if (state_ == State::BlockedOnBoth || state_ == State::BlockedOnIncoming) {
-      auto res = incoming_body_->read(0);
-      MOZ_ASSERT(!res.is_err());
-      auto [done, _] = std::move(res.unwrap());
-      if (done) {
-        set_state(engine->cx(), State::Done);
-        return true;
-      }
-      set_state(engine->cx(), State::BlockedOnOutgoing);
-    }
-
-    MOZ_ASSERT(state_ == State::BlockedOnOutgoing);
-    auto res = outgoing_body_->capacity();
-    if (res.is_err()) {
-      return false;
-    }
-    uint64_t capacity = res.unwrap();
-    if (capacity > 0) {
-      set_state(engine->cx(), State::Ready);
-    } else {
-      engine->queue_async_task(this);
-      return true;
-    }
-
-    MOZ_ASSERT(state_ == State::Ready);
-
-    // TODO: reuse a buffer for this loop
-    do {
-      auto res = incoming_body_->read(capacity);
+    // Splice until one of the streams can't make progress without blocking.
+    while (true) {
+      bool done = false;
+      auto res = outgoing_body_->splice(incoming_body_, MAX_SPLICE_SIZE, &done);
       if (res.is_err()) {
         // TODO: proper error handling.
         return false;
       }
-      auto [done, bytes] = std::move(res.unwrap());
-      if (bytes.len == 0 && !done) {
-        set_state(engine->cx(), State::BlockedOnIncoming);
-        engine->queue_async_task(this);
-        return true;
-      }
-
-      if (bytes.len > 0) {
-        outgoing_body_->write(bytes.ptr.get(), bytes.len);
-      }
-
       if (done) {
         set_state(engine->cx(), State::Done);
         return true;
       }
-
-      auto capacity_res = outgoing_body_->capacity();
-      if (capacity_res.is_err()) {
-        // TODO: proper error handling.
-        return false;
+      if (res.unwrap() == 0) {
+        break;
       }
-      capacity = capacity_res.unwrap();
-    } while (capacity > 0);
+    }
 
-    set_state(engine->cx(), State::BlockedOnOutgoing);
+    // Nothing could be moved, so either the outgoing stream has no capacity left, or the incoming
+    // stream has no data available.
+    auto capacity_res = outgoing_body_->capacity();
+    if (capacity_res.is_err()) {
+      // TODO: proper error handling.
+      return false;
+    }
+    set_state(engine->cx(),
+              capacity_res.unwrap() == 0 ? State::BlockedOnOutgoing : State::BlockedOnIncoming);
     engine->queue_async_task(this);
     return true;
   }
 
+  /// Only used if the outgoing body is closed while the task waits for buffered writes, before it
+  /// ever ran. Nothing is appended then, but the completion callback still has to run.
   [[nodiscard]] bool cancel(api::Engine *engine) override {
-    MOZ_ASSERT_UNREACHABLE("BodyAppendTask's semantics don't allow for cancellation");
+    set_state(engine->cx(), State::Done);
     return true;
   }
 
   [[nodiscard]] int32_t id() override {
-    if (state_ == State::BlockedOnBoth || state_ == State::BlockedOnIncoming) {
-      return incoming_pollable_;
-    }
-
-    MOZ_ASSERT(state_ == State::BlockedOnOutgoing,
+    MOZ_ASSERT(state_ != State::Done,
                "BodyAppendTask should only be queued if it's not known to be ready");
-    return outgoing_pollable_;
+    return state_ == State::BlockedOnIncoming ? incoming_pollable_ : outgoing_pollable_;
   }
 
+  [[nodiscard]] const char *name() const override { return "BodyAppendTask"; }
+
   void trace(JSTracer *trc) override {
     JS::TraceEdge(trc, &cb_receiver_, "BodyAppendTask completion callback receiver");
   }
@@ -580,12 +772,19 @@ public:
 Result<Void> HttpOutgoingBody::append(api::Engine *engine, HttpIncomingBody *other,
                                       api::TaskCompletionCallback callback,
                                       HandleObject callback_receiver) {
-  engine->queue_async_task(new BodyAppendTask(engine, other, this, callback, callback_receiver));
+  // Chunks queued using `write_all` must be written before any of the appended body's contents.
+  queue_after_writes(engine,
+                     new BodyAppendTask(engine, other, this, callback, callback_receiver));
   return {};
 }
 
 Result<Void> HttpOutgoingBody::close() {
   auto state = static_cast<OutgoingBodyHandle *>(handle_state_.get());
+  if (state->writer_) {
+    static_cast<BodyWriteAllTask *>(state->writer_.get())->drain_blocking();
+    state->writer_ = nullptr;
+  }
+
   // A blocking flush is required here to ensure that all buffered contents are
   // actually written before finishing the body.
   Borrow<OutputStream> borrow{state->stream_handle_};
@@ -965,12 +1164,15 @@ Result<string_view> HttpIncomingRequest::method() {
   }
   auto borrow = Borrow<HttpIncomingRequest>(handle_state_.get());
   wasi_http_types_method_t method;
-  wasi_http_types_method_incoming_request_method(borrow, &method);
+  {
+    RequestArena::Scope arena_scope;
+    wasi_http_types_method_incoming_request_method(borrow, &method);
+  }
   if (method.tag != WASI_HTTP_TYPES_METHOD_OTHER) {
     method_ = std::string(http_method_names[method.tag], strlen(http_method_names[method.tag]));
   } else {
     method_ = std::string(reinterpret_cast<char *>(method.val.other.ptr), method.val.other.len);
-    bindings_string_free(&method.val.other);
+    free_host_allocation(method.val.other.ptr);
   }
   return Result<string_view>::ok(method_);
 }
@@ -1044,4 +1246,7 @@ void exports_wasi_http_incoming_handler(exports_wasi_http_incoming_request reque
   auto *request = new host_api::HttpIncomingRequest(std::unique_ptr<host_api::HandleState>(state));
   auto res = REQUEST_HANDLER(request);
   MOZ_RELEASE_ASSERT(res);
+
+  // Everything allocated from the arena that's still in use is kept alive until it's released.
+  host_api::RequestArena::reset();
 }
@@ -104,7 +104,7 @@ void TCPSocket::close() {
 bool TCPSocket::send(HostString chunk) {
   auto state = TCPSocketHandle::cast(handle_state_.get());
   auto borrow = wasi_io_streams_borrow_output_stream(state->output_);
-  bindings_list_u8_t list{reinterpret_cast<uint8_t *>(chunk.ptr.get()), chunk.len};
+  bindings_list_u8_t list{reinterpret_cast<uint8_t *>(chunk.data()), chunk.len};
   uint64_t capacity = 0;
   wasi_io_streams_stream_error_t err;
   if (!wasi_io_streams_method_output_stream_check_write(borrow, &capacity, &err)) {
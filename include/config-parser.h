@@ -99,6 +99,23 @@ public:
         }
       } else if (args[i] == "--wpt-mode") {
         config_->wpt_mode = true;
+      } else if (args[i] == "--no-batch-dispatch") {
+        config_->event_loop_batch_dispatch = false;
+      } else if (args[i] == "--dump-event-loop-metrics") {
+        config_->dump_event_loop_metrics = true;
+      } else if (args[i] == "--max-body-read-chunk-size") {
+        if (i + 1 < args.size()) {
+          config_->max_body_read_chunk_size =
+              std::strtoul(std::string(args[i + 1]).c_str(), nullptr, 10);
+          i++;
+        }
+      } else if (args[i] == "--immediate-task-budget") {
+        if (i + 1 < args.size()) {
+          config_->immediate_task_budget = std::strtoul(std::string(args[i + 1]).c_str(), nullptr, 10);
+          i++;
+        }
+      } else if (args[i] == "--enable-compression-stream-options") {
+        config_->compression_stream_options = true;
       } else if (args[i] == "--init-location") {
         if (i + 1 < args.size()) {
           config_->init_location = mozilla::Some(args[i + 1]);
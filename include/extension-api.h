@@ -24,6 +24,10 @@ using PollableHandle = int32_t;
 constexpr PollableHandle INVALID_POLLABLE_HANDLE = -1;
 constexpr PollableHandle IMMEDIATE_TASK_HANDLE = -2;
 
+namespace core {
+class TaskQueue;
+} // namespace core
+
 namespace api {
 
 class AsyncTask;
@@ -67,6 +71,46 @@ struct EngineConfig {
    */
   bool wpt_mode = false;
 
+  /**
+   * Whether to run all async tasks found to be ready by a single poll before polling the host
+   * again. If this is disabled, the host is polled once for every task that's run.
+   */
+  bool event_loop_batch_dispatch = true;
+
+  /**
+   * The number of immediate tasks the event loop runs before checking, with a non-blocking poll,
+   * whether older I/O tasks have become ready. Immediate tasks never require a host call on their
+   * own, so a higher budget trades I/O latency for fewer host calls in pure-JS pipelines.
+   *
+   * If set to 0, the host is polled before every batch that contains immediate tasks.
+   */
+  uint32_t immediate_task_budget = 32;
+
+  /**
+   * Whether to print the event loop metrics to stderr at the end of every incoming request.
+   *
+   * This also enables measuring durations for the metrics, which takes a host call per task run.
+   * Without it, only counts are collected.
+   */
+  bool dump_event_loop_metrics = false;
+
+  /**
+   * The maximum size of the chunks incoming request and response bodies are read in.
+   *
+   * Bodies are initially read in small chunks, which grow toward this size while data keeps
+   * arriving faster than it's consumed.
+   */
+  uint32_t max_body_read_chunk_size = 1024 * 1024;
+
+  /**
+   * Whether the `CompressionStream` constructor accepts a non-standard options bag as its second
+   * argument, overriding the `level`, `windowBits`, and `memLevel` used for the zlib-based formats.
+   *
+   * The defaults for these can be changed by the initializer script regardless of this setting,
+   * using the `setCompressionStreamDefaults` function on its global.
+   */
+  bool compression_stream_options = false;
+
   EngineConfig() = default;
 };
 
@@ -85,6 +129,11 @@ public:
   EngineState state();
   bool debugging_enabled();
   bool wpt_mode();
+  bool event_loop_batch_dispatch();
+  uint32_t immediate_task_budget();
+  bool dump_event_loop_metrics_enabled();
+  uint32_t max_body_read_chunk_size();
+  bool compression_stream_options_enabled();
   const mozilla::Maybe<std::string> &init_location() const;
 
   void finish_pre_initialization();
@@ -144,8 +193,19 @@ public:
    * Every call to incr_event_loop_interest must be followed by an eventual call to
    * decr_event_loop_interest, for the event loop to complete. Otherwise, if no async tasks remain
    * pending while there's still interest in the event loop, an error will be reported.
+   *
+   * If `total_compute` is given, the time spent running JS, in microseconds, is added to it.
    */
-  bool run_event_loop();
+  bool run_event_loop(double *total_compute = nullptr);
+
+  /**
+   * Print the event loop metrics collected since the last reset.
+   *
+   * The metrics are also available to the initialization script, via the `eventLoopMetrics`
+   * function on its global.
+   */
+  void dump_event_loop_metrics(FILE *fp = stderr);
+  void reset_event_loop_metrics();
 
   /**
    * Add an event loop interest to track
@@ -187,6 +247,11 @@ public:
 using TaskCompletionCallback = bool (*)(JSContext* cx, HandleObject receiver);
 
 class AsyncTask : public js::RefCounted<AsyncTask>, public mozilla::SupportsWeakPtr {
+  friend class core::TaskQueue;
+
+  // Index of the event loop slot this task occupies while it's queued.
+  uint32_t queue_slot_ = UINT32_MAX;
+
 protected:
   PollableHandle handle_ = -1;
 
@@ -208,16 +273,35 @@ public:
     return handle_;
   }
 
+  /**
+   * The monotonic clock time at which this task becomes ready, or 0 if it isn't a timer.
+   *
+   * Tasks with a deadline are kept in the event loop's timer queue, ordered by deadline.
+   */
   [[nodiscard]] virtual uint64_t deadline() {
     return 0;
   }
 
+  /**
+   * A name identifying the type of this task, used to break down event loop metrics by task type.
+   */
+  [[nodiscard]] virtual const char *name() const {
+    return "AsyncTask";
+  }
+
   virtual void trace(JSTracer *trc) = 0;
 
   /**
-   * Select for the next available ready task, providing the oldest ready first.
+   * Poll the given set of pollables, and append the indices of all that are ready to `ready`.
+   *
+   * If `block` is true, waits until at least one pollable is ready. Otherwise, returns
+   * immediately, leaving `ready` untouched if none of the pollables are ready yet.
+   *
+   * `pollables` is owned and incrementally maintained by the event loop. Implementations may
+   * temporarily append to it, but must restore it to its original contents before returning.
    */
-  static size_t select(std::vector<RefPtr<AsyncTask>> &handles);
+  static void select(std::vector<PollableHandle> &pollables, std::vector<uint32_t> &ready,
+                     bool block);
 };
 
 } // namespace api
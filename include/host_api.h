@@ -94,68 +94,201 @@ public:
   }
 };
 
+/// A bump allocator for data that's scoped to the handling of a single incoming request, such as
+/// the names and values of its headers, its method and its URL.
+///
+/// Host calls made while a `RequestArena::Scope` is alive get their results allocated from the
+/// arena, instead of making a `malloc` call per string. The memory is handed out from chunks,
+/// each of which counts its live allocations: releasing an allocation just decrements that count.
+/// `reset` is called once the request has been handled, and frees all chunks without live
+/// allocations in one step. Chunks still in use, e.g. by headers content kept around, are freed
+/// once their last allocation is released.
+class RequestArena final {
+public:
+  class Scope final {
+  public:
+    Scope();
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+  };
+
+  /// Whether fresh allocations made by host calls are currently served from the arena.
+  static bool in_scope();
+
+  /// Allocate `size` bytes with the given alignment. Returns nullptr if `size` is too large to be
+  /// served from the arena, in which case the caller should fall back to `malloc`.
+  static void *alloc(size_t size, size_t align);
+
+  /// Whether `ptr` was allocated from the arena. Takes constant time, independent of the number of
+  /// chunks, so it can be used to check any pointer before freeing it.
+  static bool owns(const void *ptr);
+
+  /// Release `ptr` if it was allocated from the arena, returning whether it was.
+  static bool release(void *ptr);
+
+  /// Free all chunks without live allocations, and start a new scope for the next request.
+  static void reset();
+};
+
 /// A string allocated by the host interface. Holds ownership of the data.
+///
+/// Short strings, such as most header names and values, are stored inline instead of in a heap
+/// allocation. Inline data moves with the `HostString`, so pointers and `string_view`s into it
+/// are only valid for as long as the `HostString` isn't moved.
+///
+/// The data may also have been allocated from the `RequestArena`, in which case it's released to
+/// the arena instead of being freed. To hand ownership of the data over to code that frees it
+/// itself, use `release`, which copies it into a heap allocation if needed.
 struct HostString final {
-  JS::UniqueChars ptr;
+  /// The maximum length of strings that are stored inline. Inline data is always null-terminated.
+  static constexpr size_t INLINE_CAPACITY = 23;
+
   size_t len = 0;
 
   HostString() = default;
   HostString(std::nullptr_t) : HostString() {}
-  HostString(const char *c_str) {
-    len = strlen(c_str);
-    ptr = JS::UniqueChars(static_cast<char *>(malloc(len + 1)));
-    std::memcpy(ptr.get(), c_str, len);
-    ptr[len] = '\0';
-  }
+  HostString(const char *c_str) : HostString(string_view(c_str)) {}
   HostString(const string_view &str) {
-    ptr = JS::UniqueChars(
-        static_cast<char *>(std::memcpy(malloc(str.size()), str.data(), str.size())));
-    len = str.size();
+    char *buf = allocate(str.size());
+    if (buf) {
+      std::memcpy(buf, str.data(), str.size());
+    }
+  }
+  HostString(JS::UniqueChars ptr, size_t len) : len{len}, data_{ptr.release()} {}
+
+  /// Create a string of the given length with uninitialized, null-terminated data, to be filled
+  /// in via `data()`. Returns a null string if allocating the data failed.
+  static HostString with_length(size_t len) {
+    HostString ret;
+    ret.allocate(len);
+    return ret;
   }
-  HostString(JS::UniqueChars ptr, size_t len) : ptr{std::move(ptr)}, len{len} {}
 
   HostString(const HostString &other) = delete;
   HostString &operator=(const HostString &other) = delete;
 
-  HostString(HostString &&other) : ptr{std::move(other.ptr)}, len{other.len} {}
+  HostString(HostString &&other) { take(other); }
   HostString &operator=(HostString &&other) {
-    this->ptr.reset(other.ptr.release());
-    this->len = other.len;
+    if (this != &other) {
+      free_data();
+      take(other);
+    }
     return *this;
   }
 
+  ~HostString() { free_data(); }
+
   using iterator = char *;
   using const_iterator = const char *;
 
   size_t size() const { return this->len; }
 
-  iterator begin() { return this->ptr.get(); }
+  char *data() { return this->data_; }
+  const char *data() const { return this->data_; }
+
+  iterator begin() { return this->data_; }
   iterator end() { return this->begin() + this->len; }
 
-  const_iterator begin() const { return this->ptr.get(); }
+  const_iterator begin() const { return this->data_; }
   const_iterator end() const { return this->begin() + this->len; }
 
+  /// Shorten the string to `new_len` bytes.
+  void truncate(size_t new_len) {
+    MOZ_ASSERT(new_len <= this->len);
+    this->len = new_len;
+    if (is_inline()) {
+      this->inline_[new_len] = '\0';
+    }
+  }
+
+  /// Whether the data is in a heap allocation of its own, which `release` hands over as-is.
+  bool is_heap_allocated() const {
+    return this->data_ && !is_inline() && !RequestArena::owns(this->data_);
+  }
+
+  /// Give up ownership of the data, as a heap allocation that can be freed with `js_free`.
+  /// Inline and arena data are copied. Returns nullptr for a null string, or if copying failed.
+  JS::UniqueChars release() {
+    if (!this->data_) {
+      return nullptr;
+    }
+    char *heap = this->data_;
+    if (is_inline() || RequestArena::owns(heap)) {
+      heap = static_cast<char *>(js_malloc(this->len + 1));
+      if (heap) {
+        std::memcpy(heap, this->data_, this->len);
+        heap[this->len] = '\0';
+      }
+      free_data();
+    }
+    this->data_ = nullptr;
+    this->len = 0;
+    return JS::UniqueChars(heap);
+  }
+
   /// Conversion to a bool, testing for an empty pointer.
-  operator bool() const { return this->ptr != nullptr; }
+  operator bool() const { return this->data_ != nullptr; }
 
   /// Comparison against nullptr
-  bool operator==(std::nullptr_t) { return this->ptr == nullptr; }
+  bool operator==(std::nullptr_t) { return this->data_ == nullptr; }
 
   /// Comparison against nullptr
-  bool operator!=(std::nullptr_t) { return this->ptr != nullptr; }
+  bool operator!=(std::nullptr_t) { return this->data_ != nullptr; }
 
   /// Conversion to a `string_view`.
-  operator string_view() const { return string_view(this->ptr.get(), this->len); }
+  operator string_view() const { return string_view(this->data_, this->len); }
 
   /// Conversion to a `jsurl::SpecString`.
   operator jsurl::SpecString() {
-    return jsurl::SpecString(reinterpret_cast<uint8_t *>(this->ptr.release()), this->len,
-                             this->len);
+    size_t len = this->len;
+    return jsurl::SpecString(reinterpret_cast<uint8_t *>(release().release()), len, len);
   }
 
   /// Conversion to a `jsurl::SpecString`.
   operator const jsurl::SpecString() const {
-    return jsurl::SpecString(reinterpret_cast<uint8_t *>(this->ptr.get()), this->len, this->len);
+    return jsurl::SpecString(reinterpret_cast<uint8_t *>(this->data_), this->len, this->len);
+  }
+
+private:
+  // Points to `inline_`, to owned heap or arena data, or is null.
+  char *data_ = nullptr;
+  char inline_[INLINE_CAPACITY + 1];
+
+  bool is_inline() const { return this->data_ == this->inline_; }
+
+  char *allocate(size_t len) {
+    if (len <= INLINE_CAPACITY) {
+      this->data_ = this->inline_;
+    } else {
+      this->data_ = static_cast<char *>(js_malloc(len + 1));
+      if (!this->data_) {
+        return nullptr;
+      }
+    }
+    this->data_[len] = '\0';
+    this->len = len;
+    return this->data_;
+  }
+
+  void take(HostString &other) {
+    this->len = other.len;
+    if (other.is_inline()) {
+      std::memcpy(this->inline_, other.inline_, other.len + 1);
+      this->data_ = this->inline_;
+    } else {
+      this->data_ = other.data_;
+    }
+    other.data_ = nullptr;
+    other.len = 0;
+  }
+
+  void free_data() {
+    if (this->data_ && !is_inline() && !RequestArena::release(this->data_)) {
+      js_free(this->data_);
+    }
+    this->data_ = nullptr;
   }
 };
 
@@ -243,7 +376,11 @@ public:
 
 void block_on_pollable_handle(PollableHandle handle);
 
+class HttpOutgoingBody;
+
 class HttpIncomingBody final : public Pollable {
+  friend HttpOutgoingBody;
+
 public:
   HttpIncomingBody() = delete;
   explicit HttpIncomingBody(std::unique_ptr<HandleState> handle);
@@ -261,6 +398,12 @@ public:
   /// Might return an empty string if no data is available.
   Result<ReadResult> read(uint32_t chunk_size);
 
+  /// The chunk size to use for the next read.
+  ///
+  /// Not used by the host API itself: it allows callers to adapt the chunk size to the rate at
+  /// which data arrives across multiple reads.
+  uint32_t read_chunk_size = 0;
+
   /// Close this handle, and reset internal state to invalid.
   Result<Void> close();
 
@@ -284,14 +427,37 @@ public:
   /// value.
   void write(const uint8_t *bytes, size_t len);
 
-  /// Writes the given number of bytes from the given buffer to the given handle.
+  /// Queue the given bytes to be written to this handle.
+  ///
+  /// Queued chunks are written asynchronously, in order, with runs of small chunks coalesced into
+  /// as few host writes as the stream's capacity allows.
   ///
-  /// The host doesn't necessarily write all bytes in any particular call to
-  /// `write`, so to ensure all bytes are written, we call it in a loop.
-  /// TODO: turn into an async task that writes chunks of the passed buffer until done.
-  Result<Void> write_all(api::Engine *engine, HostBytes bytes, api::TaskCompletionCallback callback,
+  /// Returns `true` if the handle can immediately accept more data, in which case `callback` is
+  /// never invoked. Otherwise, `callback` is invoked once enough of the queued data was written.
+  Result<bool> write_all(api::Engine *engine, HostBytes bytes, api::TaskCompletionCallback callback,
                          HandleObject cb_receiver);
 
+  /// Wait for all data queued using `write_all` to be written.
+  ///
+  /// Returns `true` if no data is pending, in which case `callback` is never invoked. Otherwise,
+  /// `callback` is invoked once all pending data was written.
+  Result<bool> flush(api::Engine *engine, api::TaskCompletionCallback callback,
+                     HandleObject cb_receiver);
+
+  /// Queue `task` once all data queued using `write_all` has been written.
+  ///
+  /// Tasks writing to this handle directly must be queued this way, so their writes can't overtake
+  /// chunks that are still buffered.
+  void queue_after_writes(api::Engine *engine, api::AsyncTask *task);
+
+  /// Move up to `len` bytes from `source` to this handle, without copying them through guest
+  /// memory.
+  ///
+  /// Only moves as many bytes as are immediately available from `source` and can immediately be
+  /// written to this handle, which can be none. Sets `done` if `source` has reached its end, and
+  /// returns an error if this handle's stream has been closed.
+  Result<uint64_t> splice(HttpIncomingBody *source, uint64_t len, bool *done);
+
   /// Append an HttpIncomingBody to this one.
   Result<Void> append(api::Engine *engine, HttpIncomingBody *other,
                       api::TaskCompletionCallback callback, HandleObject callback_receiver);
@@ -1,8 +1,142 @@
 #include "allocator.h"
+#include "host_api.h"
 #include "js/MemoryFunctions.h"
 
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
 JSContext *CONTEXT = nullptr;
 
+namespace {
+
+// Large enough for the headers of most requests to fit into a single chunk.
+constexpr size_t ARENA_CHUNK_SIZE = 16 * 1024;
+// Larger allocations are unlikely to be short-lived strings, and would waste too much of a chunk.
+constexpr size_t ARENA_MAX_ALLOC_SIZE = ARENA_CHUNK_SIZE / 4;
+
+// Chunks are aligned to their size, and start with this header. That way, the chunk an
+// allocation belongs to can be found by masking its address, instead of searching all chunks.
+struct ArenaChunk {
+  size_t used;
+  // The number of allocations from this chunk that haven't been released yet.
+  uint32_t live;
+  // Whether the request this chunk was used for has ended, so it mustn't be allocated from.
+  bool retired;
+};
+
+constexpr size_t ARENA_CHUNK_HEADER_SIZE = (sizeof(ArenaChunk) + alignof(std::max_align_t) - 1) &
+                                           ~(alignof(std::max_align_t) - 1);
+
+// One bit per chunk-sized block of the address space, set for the blocks that are arena chunks.
+// Memory not allocated from the arena can share a block with a chunk's header, so this, not
+// the header, is what decides whether a pointer is owned by the arena.
+static_assert(sizeof(uintptr_t) == 4, "The arena's chunk map covers a 32-bit address space");
+std::bitset<(static_cast<uint64_t>(UINTPTR_MAX) + 1) / ARENA_CHUNK_SIZE> ARENA_CHUNK_MAP;
+
+// The chunks allocated from while handling the current request. Retired chunks are only
+// reachable through the allocations they still hold.
+std::vector<ArenaChunk *> ARENA_CHUNKS;
+uint32_t ARENA_SCOPE_DEPTH = 0;
+
+ArenaChunk *find_chunk(const void *ptr) {
+  auto addr = reinterpret_cast<uintptr_t>(ptr);
+  if (!ARENA_CHUNK_MAP.test(addr / ARENA_CHUNK_SIZE)) {
+    return nullptr;
+  }
+  return reinterpret_cast<ArenaChunk *>(addr & ~(ARENA_CHUNK_SIZE - 1));
+}
+
+ArenaChunk *new_chunk() {
+  auto *chunk = static_cast<ArenaChunk *>(aligned_alloc(ARENA_CHUNK_SIZE, ARENA_CHUNK_SIZE));
+  if (!chunk) {
+    return nullptr;
+  }
+  *chunk = {ARENA_CHUNK_HEADER_SIZE, 0, false};
+  ARENA_CHUNK_MAP.set(reinterpret_cast<uintptr_t>(chunk) / ARENA_CHUNK_SIZE);
+  return chunk;
+}
+
+void free_chunk(ArenaChunk *chunk) {
+  ARENA_CHUNK_MAP.reset(reinterpret_cast<uintptr_t>(chunk) / ARENA_CHUNK_SIZE);
+  free(chunk);
+}
+
+} // namespace
+
+namespace host_api {
+
+RequestArena::Scope::Scope() { ARENA_SCOPE_DEPTH++; }
+RequestArena::Scope::~Scope() {
+  MOZ_ASSERT(ARENA_SCOPE_DEPTH > 0);
+  ARENA_SCOPE_DEPTH--;
+}
+
+bool RequestArena::in_scope() { return ARENA_SCOPE_DEPTH > 0; }
+
+void *RequestArena::alloc(size_t size, size_t align) {
+  if (size > ARENA_MAX_ALLOC_SIZE) {
+    return nullptr;
+  }
+
+  // Only the last chunk is allocated from, unless it's full.
+  ArenaChunk *chunk = ARENA_CHUNKS.empty() ? nullptr : ARENA_CHUNKS.back();
+  size_t offset = 0;
+  if (chunk) {
+    offset = (chunk->used + align - 1) & ~(align - 1);
+  }
+  if (!chunk || offset + size > ARENA_CHUNK_SIZE) {
+    chunk = new_chunk();
+    if (!chunk) {
+      return nullptr;
+    }
+    ARENA_CHUNKS.push_back(chunk);
+    offset = (ARENA_CHUNK_HEADER_SIZE + align - 1) & ~(align - 1);
+  }
+
+  chunk->used = offset + size;
+  chunk->live++;
+  return reinterpret_cast<uint8_t *>(chunk) + offset;
+}
+
+bool RequestArena::owns(const void *ptr) { return ptr && find_chunk(ptr); }
+
+bool RequestArena::release(void *ptr) {
+  auto *chunk = find_chunk(ptr);
+  if (!chunk) {
+    return false;
+  }
+
+  MOZ_ASSERT(chunk->live > 0);
+  if (--chunk->live > 0) {
+    return true;
+  }
+
+  if (chunk->retired) {
+    free_chunk(chunk);
+  } else {
+    // Nothing in this chunk is in use anymore, so it can be reused from the start.
+    chunk->used = ARENA_CHUNK_HEADER_SIZE;
+  }
+  return true;
+}
+
+void RequestArena::reset() {
+  for (auto *chunk : ARENA_CHUNKS) {
+    if (chunk->live == 0) {
+      free_chunk(chunk);
+    } else {
+      chunk->retired = true;
+    }
+  }
+  ARENA_CHUNKS.clear();
+}
+
+} // namespace host_api
+
 extern "C" {
 
 __attribute__((weak, export_name("cabi_realloc"))) void *cabi_realloc(void *ptr, size_t orig_size,
@@ -10,8 +144,28 @@ __attribute__((weak, export_name("cabi_realloc"))) void *cabi_realloc(void *ptr,
   if (new_size == orig_size) {
     return ptr;
   }
+
+  if (host_api::RequestArena::in_scope() || host_api::RequestArena::owns(ptr)) {
+    void *new_ptr = nullptr;
+    if (host_api::RequestArena::in_scope()) {
+      new_ptr = host_api::RequestArena::alloc(new_size, _align);
+    }
+    if (!new_ptr) {
+      new_ptr = JS_malloc(CONTEXT, new_size);
+    }
+    if (new_ptr && ptr) {
+      memcpy(new_ptr, ptr, std::min(orig_size, new_size));
+      cabi_free(ptr);
+    }
+    return new_ptr;
+  }
+
   return JS_realloc(CONTEXT, ptr, orig_size, new_size);
 }
 
-void cabi_free(void *ptr) { JS_free(CONTEXT, ptr); }
+void cabi_free(void *ptr) {
+  if (!host_api::RequestArena::release(ptr)) {
+    JS_free(CONTEXT, ptr);
+  }
+}
 }
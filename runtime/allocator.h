@@ -14,7 +14,8 @@ extern JSContext *CONTEXT;
 extern "C" {
 
 /// A strong symbol to override the cabi_realloc defined by wit-bindgen. This
-/// version of cabi_realloc uses JS_malloc under the hood.
+/// version of cabi_realloc uses JS_malloc under the hood, or allocates from the
+/// `host_api::RequestArena` while a `RequestArena::Scope` is alive.
 void *cabi_realloc(void *ptr, size_t orig_size, size_t align, size_t new_size);
 
 /// A more ergonomic version of cabi_realloc for fresh allocations.
@@ -22,6 +23,7 @@ inline void *cabi_malloc(size_t bytes, size_t align) { return cabi_realloc(nullp
 
 /// Not required by wit-bindgen generated code, but a usefully named version of
 /// JS_free that can help with identifying where memory allocated by the c-abi.
+/// Releases the memory to the `host_api::RequestArena` if it was allocated from it.
 void cabi_free(void *ptr);
 }
 
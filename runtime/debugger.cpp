@@ -28,7 +28,7 @@ bool dbg_set_content_path(JSContext *cx, unsigned argc, Value *vp) {
     return false;
   }
 
-  main_path = mozilla::Some(path.ptr.release());
+  main_path = mozilla::Some(std::string(path.data(), path.len));
   args.rval().setUndefined();
   return true;
 }
@@ -244,7 +244,8 @@ bool initialize_debugger(JSContext *cx, uint16_t port, bool content_already_init
   }
 
   JS::SourceText<mozilla::Utf8Unit> source;
-  if (!source.init(cx, std::move(debugging_script.ptr), debugging_script.len)) {
+  size_t script_len = debugging_script.len;
+  if (!source.init(cx, debugging_script.release(), script_len)) {
     return false;
   }
 
@@ -8,9 +8,18 @@ JSString *decode(JSContext *cx, string_view str) {
 }
 
 JSString *decode_byte_string(JSContext *cx, string_view str) {
-  JS::UniqueLatin1Chars chars(
-      static_cast<JS::Latin1Char *>(std::memcpy(js_malloc(str.size()), str.data(), str.size())));
-  return JS_NewLatin1String(cx, std::move(chars), str.length());
+  // Copies directly into the new string, which for short strings means into inline storage.
+  return JS_NewStringCopyN(cx, str.data(), str.length());
+}
+
+JSString *decode_byte_string(JSContext *cx, host_api::HostString &&str) {
+  if (!str.is_heap_allocated()) {
+    return decode_byte_string(cx, string_view(str));
+  }
+
+  size_t len = str.len;
+  JS::UniqueLatin1Chars chars(reinterpret_cast<JS::Latin1Char *>(str.release().release()));
+  return JS_NewLatin1String(cx, std::move(chars), len);
 }
 
 } // namespace core
@@ -1,11 +1,17 @@
 #ifndef JS_COMPUTE_RUNTIME_DECODE_H
 #define JS_COMPUTE_RUNTIME_DECODE_H
 
+#include "host_api.h"
+
 namespace core {
 
 JSString* decode(JSContext *cx, std::string_view str);
 JSString* decode_byte_string(JSContext* cx, std::string_view str);
 
+// Like `decode_byte_string`, but hands the string's data over to the new JS string instead of
+// copying it, if it's in a heap allocation of its own.
+JSString* decode_byte_string(JSContext* cx, host_api::HostString &&str);
+
 } // namespace core
 
 #endif
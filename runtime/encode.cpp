@@ -1,20 +1,36 @@
 #include "encode.h"
 #include "js/Conversions.h"
+#include "mozilla/Span.h"
+
+#include <cstring>
+#include <tuple>
 
 namespace core {
 
 using host_api::HostString;
 
 HostString encode(JSContext *cx, JS::HandleString str) {
-  HostString res;
-  res.ptr = JS_EncodeStringToUTF8(cx, str);
-  if (res.ptr) {
-    // This shouldn't fail, since the encode operation ensured `str` is linear.
-    JSLinearString *linear = JS_EnsureLinearString(cx, str);
-    res.len = JS::GetDeflatedUTF8StringLength(linear);
+  // Short strings are encoded into the inline storage directly. Each UTF-16 code unit encodes to
+  // at most three UTF-8 bytes.
+  if (JS::GetStringLength(str) <= HostString::INLINE_CAPACITY / 3) {
+    auto res = HostString::with_length(HostString::INLINE_CAPACITY);
+    auto maybe = JS_EncodeStringToUTF8BufferPartial(
+        cx, str, mozilla::Span(res.data(), HostString::INLINE_CAPACITY));
+    if (!maybe) {
+      return HostString{};
+    }
+    res.truncate(std::get<1>(*maybe));
+    return res;
   }
 
-  return res;
+  JS::UniqueChars chars = JS_EncodeStringToUTF8(cx, str);
+  if (!chars) {
+    return HostString{};
+  }
+
+  // This shouldn't fail, since the encode operation ensured `str` is linear.
+  JSLinearString *linear = JS_EnsureLinearString(cx, str);
+  return {std::move(chars), JS::GetDeflatedUTF8StringLength(linear)};
 }
 
 HostString encode(JSContext *cx, JS::HandleValue val) {
@@ -26,51 +42,76 @@ HostString encode(JSContext *cx, JS::HandleValue val) {
   return encode(cx, str);
 }
 
+namespace {
+
+// Narrow the given UTF-16 code units to bytes, returning false if any of them is above 0xFF.
+// Checks four code units at a time, which the compiler can vectorize.
+bool narrow_to_latin1(const char16_t *src, size_t len, char *dst) {
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    uint64_t word = 0;
+    std::memcpy(&word, src + i, sizeof(word));
+    if (word & 0xFF00FF00FF00FF00ULL) {
+      return false;
+    }
+    dst[i] = static_cast<char>(src[i]);
+    dst[i + 1] = static_cast<char>(src[i + 1]);
+    dst[i + 2] = static_cast<char>(src[i + 2]);
+    dst[i + 3] = static_cast<char>(src[i + 3]);
+  }
+  for (; i < len; i++) {
+    if (src[i] > 0xFF) {
+      return false;
+    }
+    dst[i] = static_cast<char>(src[i]);
+  }
+  return true;
+}
+
+} // namespace
+
 HostString encode_byte_string(JSContext *cx, JS::HandleValue val) {
   JS::RootedString str(cx, JS::ToString(cx, val));
   if (!str) {
     return HostString{};
   }
-  size_t length = 0;
-  if (!JS::StringHasLatin1Chars(str)) {
-    bool foundBadChar = false;
-    {
-      JS::AutoCheckCannotGC nogc;
-      const char16_t* chars = JS_GetTwoByteStringCharsAndLength(cx, nogc, str, &length);
-      if (!chars) {
-        foundBadChar = true;
-      }
-      else {
-        for (size_t i = 0; i < length; i++) {
-          if (chars[i] > 255) {
-            foundBadChar = true;
-            break;
-          }
-        }
-      }
-    }
-    if (foundBadChar) {
-      api::throw_error(cx, core::ByteStringEncodingError);
-      return host_api::HostString{};
+  JSLinearString *linear = JS::StringToLinearString(cx, str);
+  if (!linear) {
+    return HostString{};
+  }
+
+  size_t length = JS::GetLinearStringLength(linear);
+  auto res = HostString::with_length(length);
+  if (!res) {
+    JS_ReportOutOfMemory(cx);
+    return res;
+  }
+
+  // Validation and extraction happen in a single pass over the string's chars.
+  bool valid = true;
+  {
+    JS::AutoCheckCannotGC nogc(cx);
+    if (JS::LinearStringHasLatin1Chars(linear)) {
+      std::memcpy(res.data(), JS::GetLatin1LinearStringChars(nogc, linear), length);
+    } else {
+      valid = narrow_to_latin1(JS::GetTwoByteLinearStringChars(nogc, linear), length, res.data());
     }
-  } else {
-    length = JS::GetStringLength(str);
   }
 
-  char *buf = static_cast<char *>(js_malloc(length));
-  if (!JS_EncodeStringToBuffer(cx, str, buf, length)) {
-    MOZ_ASSERT_UNREACHABLE();
-}
-  return {JS::UniqueChars(buf), length};
+  if (!valid) {
+    api::throw_error(cx, core::ByteStringEncodingError);
+    return HostString{};
+  }
+  return res;
 }
 
 jsurl::SpecString encode_spec_string(JSContext *cx, JS::HandleValue val) {
   jsurl::SpecString slice(nullptr, 0, 0);
   auto chars = encode(cx, val);
-  if (chars.ptr) {
-    slice.data = (uint8_t *)chars.ptr.release();
+  if (chars) {
     slice.len = chars.len;
     slice.cap = chars.len;
+    slice.data = (uint8_t *)chars.release().release();
   }
   return slice;
 }
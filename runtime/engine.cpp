@@ -273,6 +273,16 @@ bool create_content_global(JSContext * cx) {
 
 static bool define_builtin_module(JSContext *cx, unsigned argc, Value *vp);
 
+static bool event_loop_metrics(JSContext *cx, unsigned argc, Value *vp) {
+  JS::CallArgs args = CallArgsFromVp(argc, vp);
+  JSObject *metrics = core::EventLoop::metrics().to_object(cx);
+  if (!metrics) {
+    return false;
+  }
+  args.rval().setObject(*metrics);
+  return true;
+}
+
 bool create_initializer_global(Engine *engine) {
   auto *cx = engine->cx();
 
@@ -291,6 +301,7 @@ bool create_initializer_global(Engine *engine) {
   JSAutoRealm ar(cx, global);
 
   if (!JS_DefineFunction(cx, global, "defineBuiltinModule", ::define_builtin_module, 2, 0) ||
+      !JS_DefineFunction(cx, global, "eventLoopMetrics", event_loop_metrics, 0, 0) ||
       !JS_DefineProperty(cx, global, "contentGlobal", ENGINE->global(), JSPROP_READONLY) ||
       !JS_DefineFunction(cx, global, "print", content_debugger::dbg_print, 1, 0)) {
     return false;
@@ -435,7 +446,6 @@ static bool trap(JSContext *cx, unsigned argc, JS::Value *vp) {
 #endif
 
 Engine::Engine(std::unique_ptr<EngineConfig> config) {
-  // total_compute = 0;
   MOZ_ASSERT(!ENGINE);
   ENGINE = this;
   config_ = std::move(config);
@@ -520,6 +530,11 @@ bool Engine::debugging_enabled() {
   return config_->debugging;
 }
 bool Engine::wpt_mode() { return config_->wpt_mode; }
+bool Engine::event_loop_batch_dispatch() { return config_->event_loop_batch_dispatch; }
+uint32_t Engine::immediate_task_budget() { return config_->immediate_task_budget; }
+bool Engine::dump_event_loop_metrics_enabled() { return config_->dump_event_loop_metrics; }
+uint32_t Engine::max_body_read_chunk_size() { return config_->max_body_read_chunk_size; }
+bool Engine::compression_stream_options_enabled() { return config_->compression_stream_options; }
 const mozilla::Maybe<std::string> &Engine::init_location() const {
   return config_->init_location;
 }
@@ -554,7 +569,7 @@ static bool define_builtin_module(JSContext *cx, unsigned argc, Value *vp) {
     JS_ReportErrorUTF8(cx, "Second argument to defineBuiltinModule must be an object");
     return false;
   }
-  if (!Engine::get(cx)->define_builtin_module(name.ptr.get(), args.get(1))) {
+  if (!Engine::get(cx)->define_builtin_module(name.data(), args.get(1))) {
     return false;
   }
 
@@ -660,10 +675,14 @@ bool Engine::eval_toplevel(std::string_view path, MutableHandleValue result) {
   return eval_toplevel(source, path, result);
 }
 
-bool Engine::run_event_loop() {
-  return core::EventLoop::run_event_loop(this, 0);
+bool Engine::run_event_loop(double *total_compute) {
+  return core::EventLoop::run_event_loop(this, total_compute);
 }
 
+void Engine::dump_event_loop_metrics(FILE *fp) { core::EventLoop::metrics().dump(fp); }
+
+void Engine::reset_event_loop_metrics() { core::EventLoop::metrics().reset(); }
+
 void Engine::incr_event_loop_interest() {
   core::EventLoop::incr_event_loop_interest();
 }
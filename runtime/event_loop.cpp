@@ -4,43 +4,423 @@
 #include "jsapi.h"
 #include "jsfriendapi.h"
 
+#include <algorithm>
+#include <deque>
 #include <iostream>
 #include <vector>
 
-struct TaskQueue {
-  std::vector<RefPtr<api::AsyncTask>> tasks;
+namespace core {
+
+static EventLoopMetrics loop_metrics;
+
+static uint64_t elapsed_us(uint64_t start, uint64_t end) { return (end - start) / 1000; }
+
+/**
+ * The set of async tasks queued in the event loop.
+ *
+ * Tasks are stored in slots indexed by a handle kept on the task itself, which makes lookup and
+ * cancellation O(1). Each queued task is additionally referenced from one of four run queues,
+ * depending on what it's waiting for:
+ * - `immediates_`: tasks that are ready to run right away, in FIFO order.
+ * - `timers_`: tasks with a deadline, in a min-heap ordered by deadline.
+ * - `expired_`: tasks whose deadline has passed, moved over from `timers_` in deadline order.
+ * - `io_`: tasks waiting on a host pollable, in the order they were queued.
+ *
+ * Removing a task leaves a tombstone in its run queue. Tombstones are skipped when encountered at
+ * the head of a queue, and compacted away once they outnumber the live entries.
+ *
+ * The pollables of all I/O tasks are kept in a persistent array that's passed to the host as-is,
+ * and is patched in O(1) whenever a task is added or removed. Timers don't have pollables of their
+ * own: instead, the array contains a single clock pollable for the earliest deadline.
+ *
+ * Tasks are run in batches: all tasks reported as ready by a single poll, together with the
+ * immediate tasks and expired timers at that point, are run oldest-first before the host is polled
+ * again. Expired timers are run in deadline order.
+ *
+ * Immediate tasks don't need the host to become ready, so batches of them are started without a
+ * host call. To keep I/O from being starved by tasks that keep re-queueing themselves—as stream
+ * pipes do—a non-blocking poll is interleaved once a budget of immediate tasks has been run.
+ */
+class TaskQueue {
+  static constexpr uint32_t NO_SLOT = UINT32_MAX;
+  static constexpr uint32_t NO_POLLABLE = UINT32_MAX;
+  static constexpr uint32_t CLOCK_OWNER = UINT32_MAX - 1;
+  static constexpr size_t MIN_COMPACTION_TOMBSTONES = 64;
+
+  struct Slot {
+    RefPtr<api::AsyncTask> task;
+    uint64_t seq = 0;
+    uint32_t pollable_index = NO_POLLABLE;
+  };
+
+  struct Entry {
+    uint32_t slot;
+    uint64_t seq;
+  };
+
+  struct TimerEntry {
+    uint64_t deadline;
+    uint32_t slot;
+    uint64_t seq;
+
+    // Inverted, so that the std heap algorithms produce a min-heap.
+    bool operator<(const TimerEntry &other) const {
+      return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+    }
+  };
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  std::deque<Entry> immediates_;
+  std::vector<TimerEntry> timers_;
+  std::deque<Entry> expired_;
+  std::deque<Entry> io_;
+
+  // The pollable set handed to the host, and the slot (or `CLOCK_OWNER`) each entry belongs to.
+  std::vector<PollableHandle> pollables_;
+  std::vector<uint32_t> pollable_owners_;
+
+  // The clock pollable for the earliest timer deadline, if any timers are pending.
+  PollableHandle clock_pollable_ = INVALID_POLLABLE_HANDLE;
+  uint32_t clock_pollable_index_ = NO_POLLABLE;
+  uint64_t clock_deadline_ = 0;
+
+  // The current batch of tasks to run, oldest first, and the position of the next one in it.
+  std::vector<Entry> batch_;
+  size_t batch_pos_ = 0;
+  std::vector<Entry> ready_;
+  std::vector<uint32_t> ready_indices_;
+
+  // The number of immediate tasks added to batches since the host was last polled.
+  uint32_t immediates_since_poll_ = 0;
+
+  uint64_t next_seq_ = 1;
+  size_t live_ = 0;
+  size_t tombstones_ = 0;
+
+  [[nodiscard]] bool is_live(uint32_t slot, uint64_t seq) const {
+    return slots_[slot].task && slots_[slot].seq == seq;
+  }
+
+  void set_pollable_index(uint32_t owner, uint32_t index) {
+    if (owner == CLOCK_OWNER) {
+      clock_pollable_index_ = index;
+    } else {
+      slots_[owner].pollable_index = index;
+    }
+  }
+
+  void add_pollable(PollableHandle handle, uint32_t owner) {
+    set_pollable_index(owner, pollables_.size());
+    pollables_.push_back(handle);
+    pollable_owners_.push_back(owner);
+  }
+
+  void remove_pollable(uint32_t index) {
+    MOZ_ASSERT(index < pollables_.size());
+    uint32_t last = pollables_.size() - 1;
+    set_pollable_index(pollable_owners_[index], NO_POLLABLE);
+    if (index != last) {
+      pollables_[index] = pollables_[last];
+      pollable_owners_[index] = pollable_owners_[last];
+      set_pollable_index(pollable_owners_[index], index);
+    }
+    pollables_.pop_back();
+    pollable_owners_.pop_back();
+  }
+
+  RefPtr<api::AsyncTask> release(uint32_t slot) {
+    if (slots_[slot].pollable_index != NO_POLLABLE) {
+      remove_pollable(slots_[slot].pollable_index);
+    }
+    RefPtr<api::AsyncTask> task = std::move(slots_[slot].task);
+    slots_[slot].task = nullptr;
+    task->queue_slot_ = NO_SLOT;
+    free_slots_.push_back(slot);
+    live_--;
+    tombstones_++;
+    return task;
+  }
+
+  template <typename Queue> void prune_front(Queue &queue) {
+    while (!queue.empty() && !is_live(queue.front().slot, queue.front().seq)) {
+      queue.pop_front();
+      tombstones_--;
+    }
+  }
+
+  void pop_timer() {
+    std::pop_heap(timers_.begin(), timers_.end());
+    timers_.pop_back();
+  }
+
+  void prune() {
+    prune_front(immediates_);
+    prune_front(expired_);
+    prune_front(io_);
+    while (!timers_.empty() && !is_live(timers_.front().slot, timers_.front().seq)) {
+      pop_timer();
+      tombstones_--;
+    }
+  }
+
+  void maybe_compact() {
+    if (tombstones_ < MIN_COMPACTION_TOMBSTONES || tombstones_ <= live_) {
+      return;
+    }
+    auto dead = [this](const auto &entry) { return !is_live(entry.slot, entry.seq); };
+    std::erase_if(immediates_, dead);
+    std::erase_if(expired_, dead);
+    std::erase_if(io_, dead);
+    std::erase_if(timers_, dead);
+    std::make_heap(timers_.begin(), timers_.end());
+    tombstones_ = 0;
+  }
+
+  /**
+   * Move all timers whose deadline has passed over to `expired_`, in deadline order.
+   */
+  void expire_timers() {
+    if (timers_.empty()) {
+      return;
+    }
+    uint64_t now = host_api::MonotonicClock::now();
+    while (!timers_.empty() && timers_.front().deadline <= now) {
+      const TimerEntry &timer = timers_.front();
+      if (is_live(timer.slot, timer.seq)) {
+        expired_.push_back({timer.slot, timer.seq});
+      } else {
+        tombstones_--;
+      }
+      pop_timer();
+    }
+  }
+
+  /**
+   * Ensure that the pollable set contains a clock pollable for the earliest pending deadline.
+   *
+   * The clock pollable is only replaced if the earliest deadline changed since the last poll.
+   */
+  void sync_clock_pollable() {
+    while (!timers_.empty() && !is_live(timers_.front().slot, timers_.front().seq)) {
+      pop_timer();
+      tombstones_--;
+    }
+    uint64_t deadline = timers_.empty() ? 0 : timers_.front().deadline;
+    if (deadline == clock_deadline_) {
+      return;
+    }
+    if (clock_pollable_ != INVALID_POLLABLE_HANDLE) {
+      remove_pollable(clock_pollable_index_);
+      host_api::MonotonicClock::unsubscribe(clock_pollable_);
+      clock_pollable_ = INVALID_POLLABLE_HANDLE;
+    }
+    clock_deadline_ = deadline;
+    if (deadline) {
+      clock_pollable_ = host_api::MonotonicClock::subscribe(deadline, true);
+      add_pollable(clock_pollable_, CLOCK_OWNER);
+    }
+  }
+
+  /**
+   * Poll the host, and add all I/O tasks that are ready to `ready_`. If the clock pollable is
+   * ready, the timers that are due are moved to `expired_`.
+   */
+  void poll(bool block) {
+    sync_clock_pollable();
+    MOZ_ASSERT(!pollables_.empty());
+    ready_indices_.clear();
+    if (loop_metrics.timed) {
+      uint64_t start = host_api::MonotonicClock::now();
+      api::AsyncTask::select(pollables_, ready_indices_, block);
+      loop_metrics.poll_time.record(elapsed_us(start, host_api::MonotonicClock::now()));
+    } else {
+      api::AsyncTask::select(pollables_, ready_indices_, block);
+      loop_metrics.poll_time.increment();
+    }
+    (block ? loop_metrics.blocking_polls : loop_metrics.non_blocking_polls)++;
+    immediates_since_poll_ = 0;
+    MOZ_ASSERT_IF(block, !ready_indices_.empty());
+
+    bool clock_ready = false;
+    for (uint32_t index : ready_indices_) {
+      uint32_t owner = pollable_owners_[index];
+      if (owner == CLOCK_OWNER) {
+        clock_ready = true;
+      } else {
+        ready_.push_back({owner, slots_[owner].seq});
+      }
+    }
+    if (clock_ready) {
+      expire_timers();
+    }
+  }
+
+  /**
+   * The sequence number of the oldest task that's ready without consulting the host.
+   */
+  [[nodiscard]] uint64_t oldest_ready_seq() const {
+    uint64_t seq = UINT64_MAX;
+    if (!immediates_.empty()) {
+      seq = immediates_.front().seq;
+    }
+    for (const auto &entry : expired_) {
+      seq = std::min(seq, entry.seq);
+    }
+    return seq;
+  }
+
+public:
   int interest_cnt = 0;
   bool event_loop_running = false;
 
+  [[nodiscard]] bool empty() const { return live_ == 0; }
+
+  void push(const RefPtr<api::AsyncTask> &task) {
+    MOZ_ASSERT(task->queue_slot_ == NO_SLOT, "Task is already queued");
+    uint32_t slot;
+    if (!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      slot = slots_.size();
+      slots_.emplace_back();
+    }
+
+    uint64_t seq = next_seq_++;
+    slots_[slot].task = task;
+    slots_[slot].seq = seq;
+    task->queue_slot_ = slot;
+    live_++;
+
+    if (uint64_t deadline = task->deadline()) {
+      timers_.push_back({deadline, slot, seq});
+      std::push_heap(timers_.begin(), timers_.end());
+    } else if (task->id() == IMMEDIATE_TASK_HANDLE) {
+      immediates_.push_back({slot, seq});
+    } else {
+      io_.push_back({slot, seq});
+      add_pollable(task->id(), slot);
+    }
+  }
+
+  bool remove(api::AsyncTask *task) {
+    uint32_t slot = task->queue_slot_;
+    if (slot == NO_SLOT || slots_[slot].task != task) {
+      return false;
+    }
+    release(slot);
+    maybe_compact();
+    return true;
+  }
+
+  /**
+   * Start a new batch of tasks to run.
+   *
+   * In batched mode, the batch contains all tasks reported as ready by a single poll, plus all
+   * immediate tasks and expired timers at that point. Otherwise, it only contains the oldest of
+   * those. Expired timers are ordered by deadline, and all other tasks by age.
+   *
+   * Immediate tasks and expired timers are always ready, so if there are any, the host only needs
+   * to be polled—without blocking—if I/O tasks were queued before the oldest of them, and at least
+   * `immediate_budget` immediate tasks were run since the last poll.
+   */
+  void fill_batch(bool batched, uint32_t immediate_budget) {
+    MOZ_ASSERT(!empty());
+    loop_metrics.turns++;
+    loop_metrics.queue_depth.record(live_);
+    prune();
+    expire_timers();
+    batch_.clear();
+    batch_pos_ = 0;
+    ready_.clear();
+
+    if (immediates_.empty() && expired_.empty()) {
+      poll(true);
+    } else if (!io_.empty() && io_.front().seq < oldest_ready_seq() &&
+               (immediates_.empty() || immediates_since_poll_ >= immediate_budget)) {
+      poll(false);
+    }
+
+    for (const auto &entry : immediates_) {
+      if (is_live(entry.slot, entry.seq)) {
+        ready_.push_back(entry);
+        immediates_since_poll_++;
+        if (!batched) {
+          break;
+        }
+      }
+    }
+    std::sort(ready_.begin(), ready_.end(),
+              [](const Entry &a, const Entry &b) { return a.seq < b.seq; });
+
+    // Merge expired timers in deadline order with all other ready tasks in age order.
+    auto ready = ready_.begin();
+    for (const auto &timer : expired_) {
+      if (!is_live(timer.slot, timer.seq)) {
+        continue;
+      }
+      while (ready != ready_.end() && ready->seq < timer.seq) {
+        batch_.push_back(*ready++);
+      }
+      batch_.push_back(timer);
+    }
+    batch_.insert(batch_.end(), ready, ready_.end());
+
+    if (!batched && !batch_.empty()) {
+      batch_.resize(1);
+    }
+    loop_metrics.tasks_per_turn.record(batch_.size());
+  }
+
+  /**
+   * Remove the next task of the current batch from the queue and return it, or return nullptr if
+   * the batch is exhausted.
+   *
+   * Tasks that were removed from the queue after the batch was started—e.g., because an earlier
+   * task in the same batch cancelled them—are skipped.
+   */
+  RefPtr<api::AsyncTask> next_in_batch() {
+    while (batch_pos_ < batch_.size()) {
+      Entry entry = batch_[batch_pos_++];
+      if (is_live(entry.slot, entry.seq)) {
+        return release(entry.slot);
+      }
+    }
+    return nullptr;
+  }
+
   void trace(JSTracer *trc) const {
-    for (const auto &task : tasks) {
-      task->trace(trc);
+    for (const auto &slot : slots_) {
+      if (slot.task) {
+        slot.task->trace(trc);
+      }
     }
   }
 };
 
-static PersistentRooted<TaskQueue> queue;
+} // namespace core
+
+static PersistentRooted<core::TaskQueue> queue;
 
 namespace core {
 
 void EventLoop::queue_async_task(const RefPtr<api::AsyncTask>& task) {
   MOZ_ASSERT(task);
-  queue.get().tasks.emplace_back(task);
+  queue.get().push(task);
 }
 
 bool EventLoop::cancel_async_task(api::Engine *engine, const RefPtr<api::AsyncTask>& task) {
-  auto *const tasks = &queue.get().tasks;
-  for (auto it = tasks->begin(); it != tasks->end(); ++it) {
-    if (*it == task) {
-      tasks->erase(it);
-      task->cancel(engine);
-      return true;
-    }
+  if (!queue.get().remove(task)) {
+    return false;
   }
-  return false;
+  task->cancel(engine);
+  return true;
 }
 
-bool EventLoop::has_pending_async_tasks() { return !queue.get().tasks.empty(); }
+EventLoopMetrics &EventLoop::metrics() { return loop_metrics; }
+
+bool EventLoop::has_pending_async_tasks() { return !queue.get().empty(); }
 
 void EventLoop::incr_event_loop_interest() { queue.get().interest_cnt++; }
 
@@ -53,7 +433,19 @@ inline bool interest_complete() { return queue.get().interest_cnt == 0; }
 
 inline void exit_event_loop() { queue.get().event_loop_running = false; }
 
-bool EventLoop::run_event_loop(api::Engine *engine, double total_compute) {
+/**
+ * Account the time spent running JS between `start` and `end`, and return it in microseconds.
+ */
+static uint64_t add_compute_time(uint64_t start, uint64_t end, double *total_compute) {
+  uint64_t duration = elapsed_us(start, end);
+  loop_metrics.compute_time += duration;
+  if (total_compute) {
+    *total_compute += static_cast<double>(duration);
+  }
+  return duration;
+}
+
+bool EventLoop::run_event_loop(api::Engine *engine, double *total_compute) {
   if (queue.get().event_loop_running) {
     fprintf(stderr, "cannot run event loop as it is already running");
     return false;
@@ -61,9 +453,23 @@ bool EventLoop::run_event_loop(api::Engine *engine, double total_compute) {
   queue.get().event_loop_running = true;
   JSContext *cx = engine->cx();
 
+  // Timing takes host calls, so it's only done if the metrics are going to be dumped. Each
+  // measurement starts where the previous one ended, so it takes a single clock read.
+  bool timed = engine->dump_event_loop_metrics_enabled();
+  loop_metrics.timed = timed;
+  uint64_t now = timed ? host_api::MonotonicClock::now() : 0;
+  uint64_t turn_start = 0;
+
   while (true) {
     // Run a microtask checkpoint
     js::RunJobs(cx);
+    if (timed) {
+      uint64_t end = host_api::MonotonicClock::now();
+      loop_metrics.run_jobs_time.record(add_compute_time(now, end, total_compute));
+      now = end;
+    } else {
+      loop_metrics.run_jobs_time.increment();
+    }
 
     if (JS_IsExceptionPending(cx)) {
       exit_event_loop();
@@ -75,20 +481,39 @@ bool EventLoop::run_event_loop(api::Engine *engine, double total_compute) {
       return true;
     }
 
-    auto *const tasks = &queue.get().tasks;
-    size_t tasks_size = tasks->size();
-    if (tasks_size == 0) {
+    if (queue.get().empty()) {
       exit_event_loop();
       MOZ_ASSERT(!interest_complete());
       return false;
     }
 
-    // Select the next task to run according to event-loop semantics of oldest-first.
-    size_t task_idx = api::AsyncTask::select(*tasks);
-
-    auto task = tasks->at(task_idx);
-    tasks->erase(tasks->begin() + task_idx);
+    // Select the next task to run according to event-loop semantics of oldest-first. All tasks of
+    // a batch are run, with a microtask checkpoint after each, before the host is polled again.
+    auto task = queue.get().next_in_batch();
+    if (!task) {
+      if (timed && turn_start) {
+        loop_metrics.turn_time.record(elapsed_us(turn_start, now));
+      }
+      queue.get().fill_batch(engine->event_loop_batch_dispatch(), engine->immediate_task_budget());
+      if (timed) {
+        // Polling isn't compute time, so measurements restart after it.
+        now = host_api::MonotonicClock::now();
+        turn_start = now;
+      }
+      task = queue.get().next_in_batch();
+      // The clock pollable can resolve marginally before the deadline it was subscribed for.
+      if (!task) {
+        continue;
+      }
+    }
     bool success = task->run(engine);
+    if (timed) {
+      uint64_t end = host_api::MonotonicClock::now();
+      loop_metrics.record_task(task->name(), add_compute_time(now, end, total_compute));
+      now = end;
+    } else {
+      loop_metrics.count_task(task->name());
+    }
     if (!success) {
       exit_event_loop();
       return false;
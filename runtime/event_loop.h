@@ -1,6 +1,7 @@
 #ifndef JS_COMPUTE_RUNTIME_EVENT_LOOP_H
 #define JS_COMPUTE_RUNTIME_EVENT_LOOP_H
 
+#include "event_loop_metrics.h"
 #include "extension-api.h"
 #include "jsapi.h"
 
@@ -22,7 +23,7 @@ public:
    * Run the event loop until all interests are complete.
    * See run_event_loop in extension-api.h for the complete description.
    */
-  static bool run_event_loop(api::Engine *engine, double total_compute);
+  static bool run_event_loop(api::Engine *engine, double *total_compute);
 
   static void incr_event_loop_interest();
   static void decr_event_loop_interest();
@@ -41,6 +42,11 @@ public:
    * Remove a queued async task.
    */
   static bool cancel_async_task(api::Engine *engine, const RefPtr<api::AsyncTask>& task);
+
+  /**
+   * The metrics collected while running the event loop.
+   */
+  static EventLoopMetrics &metrics();
 };
 
 } // namespace core
@@ -0,0 +1,150 @@
+#include "event_loop_metrics.h"
+
+#include "js/Array.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace core {
+
+void Histogram::record(uint64_t value) {
+  size_t bucket = std::min(static_cast<size_t>(std::bit_width(value)), BUCKET_COUNT - 1);
+  buckets_[bucket]++;
+  count_++;
+  sum_ += value;
+  max_ = std::max(max_, value);
+}
+
+void Histogram::dump(FILE *fp, const char *label, const char *unit) const {
+  fprintf(fp, "  %s: count=%llu sum=%llu%s avg=%llu%s max=%llu%s\n", label,
+          static_cast<unsigned long long>(count_), static_cast<unsigned long long>(sum_), unit,
+          static_cast<unsigned long long>(count_ ? sum_ / count_ : 0), unit,
+          static_cast<unsigned long long>(max_), unit);
+  if (!count_) {
+    return;
+  }
+  fprintf(fp, "   ");
+  for (size_t i = 0; i < BUCKET_COUNT; i++) {
+    if (buckets_[i]) {
+      fprintf(fp, " <%llu:%llu", 1ULL << i, static_cast<unsigned long long>(buckets_[i]));
+    }
+  }
+  fprintf(fp, "\n");
+}
+
+JSObject *Histogram::to_object(JSContext *cx) const {
+  JS::RootedObject obj(cx, JS_NewPlainObject(cx));
+  if (!obj) {
+    return nullptr;
+  }
+
+  // Trailing empty buckets are omitted.
+  size_t len = BUCKET_COUNT;
+  while (len > 0 && !buckets_[len - 1]) {
+    len--;
+  }
+  JS::RootedObject buckets(cx, JS::NewArrayObject(cx, len));
+  if (!buckets) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (!JS_SetElement(cx, buckets, i, static_cast<double>(buckets_[i]))) {
+      return nullptr;
+    }
+  }
+
+  if (!JS_DefineProperty(cx, obj, "count", static_cast<double>(count_), JSPROP_ENUMERATE) ||
+      !JS_DefineProperty(cx, obj, "sum", static_cast<double>(sum_), JSPROP_ENUMERATE) ||
+      !JS_DefineProperty(cx, obj, "max", static_cast<double>(max_), JSPROP_ENUMERATE) ||
+      !JS_DefineProperty(cx, obj, "buckets", buckets, JSPROP_ENUMERATE)) {
+    return nullptr;
+  }
+  return obj;
+}
+
+Histogram &EventLoopMetrics::task_stats(const char *name) {
+  // There's only a handful of task types, so a linear scan over them is cheaper than hashing.
+  for (auto &stats : tasks_) {
+    if (stats.name == name) {
+      return stats.run_time;
+    }
+  }
+  tasks_.push_back({name, {}});
+  return tasks_.back().run_time;
+}
+
+void EventLoopMetrics::record_task(const char *name, uint64_t duration) {
+  task_run_time.record(duration);
+  task_stats(name).record(duration);
+}
+
+void EventLoopMetrics::count_task(const char *name) {
+  task_run_time.increment();
+  task_stats(name).increment();
+}
+
+void EventLoopMetrics::reset() {
+  *this = EventLoopMetrics();
+}
+
+void EventLoopMetrics::dump(FILE *fp) const {
+  fprintf(fp, "Event loop metrics: turns=%llu blocking_polls=%llu non_blocking_polls=%llu "
+              "compute=%lluus\n",
+          static_cast<unsigned long long>(turns), static_cast<unsigned long long>(blocking_polls),
+          static_cast<unsigned long long>(non_blocking_polls),
+          static_cast<unsigned long long>(compute_time));
+  turn_time.dump(fp, "turn", "us");
+  run_jobs_time.dump(fp, "run_jobs", "us");
+  poll_time.dump(fp, "poll", "us");
+  queue_depth.dump(fp, "queue_depth", "");
+  tasks_per_turn.dump(fp, "tasks_per_turn", "");
+  task_run_time.dump(fp, "task_run", "us");
+  for (const auto &stats : tasks_) {
+    stats.run_time.dump(fp, stats.name, "us");
+  }
+}
+
+JSObject *EventLoopMetrics::to_object(JSContext *cx) const {
+  JS::RootedObject obj(cx, JS_NewPlainObject(cx));
+  if (!obj) {
+    return nullptr;
+  }
+
+  if (!JS_DefineProperty(cx, obj, "turns", static_cast<double>(turns), JSPROP_ENUMERATE) ||
+      !JS_DefineProperty(cx, obj, "blockingPolls", static_cast<double>(blocking_polls),
+                         JSPROP_ENUMERATE) ||
+      !JS_DefineProperty(cx, obj, "nonBlockingPolls", static_cast<double>(non_blocking_polls),
+                         JSPROP_ENUMERATE) ||
+      !JS_DefineProperty(cx, obj, "computeTime", static_cast<double>(compute_time),
+                         JSPROP_ENUMERATE)) {
+    return nullptr;
+  }
+
+  const std::pair<const char *, const Histogram *> histograms[] = {
+      {"turnTime", &turn_time},     {"runJobsTime", &run_jobs_time},
+      {"pollTime", &poll_time},     {"queueDepth", &queue_depth},
+      {"tasksPerTurn", &tasks_per_turn}, {"taskRunTime", &task_run_time},
+  };
+  JS::RootedObject histogram(cx);
+  for (const auto &[name, hist] : histograms) {
+    histogram = hist->to_object(cx);
+    if (!histogram || !JS_DefineProperty(cx, obj, name, histogram, JSPROP_ENUMERATE)) {
+      return nullptr;
+    }
+  }
+
+  JS::RootedObject tasks(cx, JS_NewPlainObject(cx));
+  if (!tasks || !JS_DefineProperty(cx, obj, "tasks", tasks, JSPROP_ENUMERATE)) {
+    return nullptr;
+  }
+  for (const auto &stats : tasks_) {
+    histogram = stats.run_time.to_object(cx);
+    if (!histogram || !JS_DefineProperty(cx, tasks, stats.name, histogram, JSPROP_ENUMERATE)) {
+      return nullptr;
+    }
+  }
+
+  return obj;
+}
+
+} // namespace core
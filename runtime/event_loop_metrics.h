@@ -0,0 +1,93 @@
+#ifndef JS_COMPUTE_RUNTIME_EVENT_LOOP_METRICS_H
+#define JS_COMPUTE_RUNTIME_EVENT_LOOP_METRICS_H
+
+#include "jsapi.h"
+
+#include <array>
+#include <cstdio>
+#include <vector>
+
+namespace core {
+
+/**
+ * A histogram with power-of-two buckets.
+ *
+ * Bucket 0 counts the value 0, and bucket `i` counts values in `[2^(i-1), 2^i)`. The last bucket
+ * is open-ended. Recording a value is a handful of integer operations and never allocates.
+ */
+class Histogram {
+public:
+  static constexpr size_t BUCKET_COUNT = 32;
+
+  void record(uint64_t value);
+
+  /**
+   * Count an occurrence without recording a value, for when the value wasn't measured.
+   */
+  void increment() { count_++; }
+
+  [[nodiscard]] uint64_t count() const { return count_; }
+  [[nodiscard]] uint64_t sum() const { return sum_; }
+  [[nodiscard]] uint64_t max() const { return max_; }
+
+  void dump(FILE *fp, const char *label, const char *unit) const;
+  JSObject *to_object(JSContext *cx) const;
+
+private:
+  std::array<uint64_t, BUCKET_COUNT> buckets_ = {};
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+};
+
+/**
+ * Counters and histograms describing where the event loop spends its time.
+ *
+ * All durations are in microseconds. A turn is one poll of the host followed by the batch of tasks
+ * run in response, see `TaskQueue::fill_batch`.
+ *
+ * Task statistics are kept per `AsyncTask` subclass, keyed by `AsyncTask::name()`.
+ *
+ * Measuring durations requires reading the host's clock, so it's only done if `timed` is set.
+ * Otherwise, the duration histograms only count occurrences, and their sums stay at 0.
+ */
+class EventLoopMetrics {
+public:
+  struct TaskStats {
+    const char *name;
+    Histogram run_time;
+  };
+
+  Histogram turn_time;
+  Histogram run_jobs_time;
+  Histogram poll_time;
+  Histogram queue_depth;
+  Histogram tasks_per_turn;
+  Histogram task_run_time;
+  uint64_t turns = 0;
+  uint64_t blocking_polls = 0;
+  uint64_t non_blocking_polls = 0;
+
+  /**
+   * Total time spent running JS, i.e. in microtask checkpoints and async tasks.
+   */
+  uint64_t compute_time = 0;
+
+  bool timed = false;
+
+  void record_task(const char *name, uint64_t duration);
+  void count_task(const char *name);
+
+  void reset();
+  void dump(FILE *fp = stderr) const;
+  JSObject *to_object(JSContext *cx) const;
+
+private:
+  Histogram &task_stats(const char *name);
+
+  std::vector<TaskStats> tasks_;
+};
+
+} // namespace core
+
+#endif
@@ -250,7 +250,7 @@ static JSObject* get_builtin_module(JSContext* cx, HandleValue id, HandleObject
       return nullptr;
     }
     auto key_str = core::encode(cx, key);
-    code += std::string_view(key_str.ptr.get(), key_str.len);
+    code += std::string_view(key_str);
     code += "': ";
 
     code += "e";
@@ -277,7 +277,7 @@ static JSObject* get_builtin_module(JSContext* cx, HandleValue id, HandleObject
       return nullptr;
     }
     auto key_str = core::encode(cx, key);
-    code += std::string_view(key_str.ptr.get(), key_str.len);
+    code += std::string_view(key_str);
     code += "'";
   }
   code += " }\n";
@@ -343,7 +343,7 @@ JSObject* module_resolve_hook(JSContext* cx, HandleValue referencingPrivate,
   }
 
   HostString str = core::encode(cx, parent_path_val);
-  auto resolved_path = resolve_path(path.get(), str.ptr.get());
+  auto resolved_path = resolve_path(path.get(), str.data());
 
   JS::CompileOptions opts(cx, *COMPILE_OPTS);
   auto stripped = strip_prefix(resolved_path, PATH_PREFIX);
@@ -0,0 +1,41 @@
+import { get } from "eventLoopMetrics";
+
+const PLAIN = 'hello\n'.repeat(10000) + 'world\n';
+
+function taskRuns(name) {
+  const task = get().tasks[name];
+  return task ? task.count : 0;
+}
+
+async function handle(event) {
+  const url = event.request.url;
+  if (url.endsWith('/plain')) {
+    return new Response(PLAIN);
+  }
+  if (url.endsWith('/sink')) {
+    return new Response(String((await event.request.text()).length));
+  }
+
+  // An incoming body stream that's passed on without being read is forwarded on the host side,
+  // without reading it in chunks through JS.
+  let upstream = await fetch(url + 'plain');
+  let before = taskRuns('BodyFutureTask');
+  let sink = await fetch(url + 'sink', { method: 'POST', body: upstream.body });
+  const forwarded = `${await sink.text()} bytes, ` +
+    `${taskRuns('BodyFutureTask') > before ? 'read in JS' : 'native'}`;
+
+  // Once content has read from the stream, the remainder has to go through JS.
+  upstream = await fetch(url + 'plain');
+  const reader = upstream.body.getReader();
+  const first = await reader.read();
+  reader.releaseLock();
+  before = taskRuns('BodyFutureTask');
+  sink = await fetch(url + 'sink', { method: 'POST', body: upstream.body });
+  const remainder = Number(await sink.text()) + first.value.length;
+  const partial = `${remainder} bytes, ` +
+    `${taskRuns('BodyFutureTask') > before ? 'read in JS' : 'native'}`;
+
+  return new Response(`forwarded: ${forwarded}\npartially read: ${partial}\n`);
+}
+
+addEventListener('fetch', (event) => { event.respondWith(handle(event)) });
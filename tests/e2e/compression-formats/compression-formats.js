@@ -0,0 +1,156 @@
+const FORMATS = ['br', 'brotli', 'zstd'];
+
+// "Hello, zstd!\n", compressed with the zstd command line tool, with and without a checksum.
+const ZSTD_HELLO = new Uint8Array([
+  0x28, 0xb5, 0x2f, 0xfd, 0x00, 0x58, 0x69, 0x00, 0x00, 0x48, 0x65, 0x6c,
+  0x6c, 0x6f, 0x2c, 0x20, 0x7a, 0x73, 0x74, 0x64, 0x21, 0x0a,
+]);
+const ZSTD_HELLO_CHECKSUM = new Uint8Array([
+  0x28, 0xb5, 0x2f, 0xfd, 0x04, 0x58, 0x69, 0x00, 0x00, 0x48, 0x65, 0x6c,
+  0x6c, 0x6f, 0x2c, 0x20, 0x7a, 0x73, 0x74, 0x64, 0x21, 0x0a, 0x41, 0xb4,
+  0x53, 0xb2,
+]);
+// "hi\n" as a single raw block, in frames declaring an 8MiB and a 128MiB window, respectively.
+const ZSTD_WINDOW_8M = new Uint8Array([
+  0x28, 0xb5, 0x2f, 0xfd, 0x00, 0x68, 0x19, 0x00, 0x00, 0x68, 0x69, 0x0a,
+]);
+const ZSTD_WINDOW_128M = new Uint8Array([
+  0x28, 0xb5, 0x2f, 0xfd, 0x00, 0x88, 0x19, 0x00, 0x00, 0x68, 0x69, 0x0a,
+]);
+// An empty brotli stream: a 64KiB window, followed by an empty last meta-block.
+const BROTLI_EMPTY = new Uint8Array([0x06]);
+
+async function collect(stream) {
+  return new Uint8Array(await new Response(stream).arrayBuffer());
+}
+
+// Writes all chunks to the transform's writable end, and returns its readable end's contents.
+async function run(transform, chunks) {
+  const output = collect(transform.readable);
+  // Errors are reported through the writer as well.
+  output.catch(() => {});
+  const writer = transform.writable.getWriter();
+  for (const chunk of chunks) {
+    await writer.write(chunk);
+  }
+  await writer.close();
+  return output;
+}
+
+function concat(chunks) {
+  const result = new Uint8Array(chunks.reduce((len, chunk) => len + chunk.length, 0));
+  let offset = 0;
+  for (const chunk of chunks) {
+    result.set(chunk, offset);
+    offset += chunk.length;
+  }
+  return result;
+}
+
+function equal(a, b) {
+  return a.length === b.length && a.every((byte, i) => byte === b[i]);
+}
+
+async function check(results, name, fn) {
+  try {
+    results.push(`${name}: ${await fn()}`);
+  } catch (e) {
+    results.push(`${name}: ${e.name}`);
+  }
+}
+
+async function handle(event) {
+  const url = event.request.url;
+  const format = new URL(url).searchParams.get('format');
+  if (url.includes('/plain')) {
+    return new Response('hello\n'.repeat(1000) + 'world\n');
+  }
+  if (url.includes('/compressed')) {
+    const response = await fetch(url.replace('/compressed', '/plain'));
+    return new Response(response.body.pipeThrough(new CompressionStream(format)));
+  }
+
+  const encoder = new TextEncoder();
+  const decoder = new TextDecoder();
+  const chunks = [];
+  for (let i = 0; i < 64; i++) {
+    chunks.push(encoder.encode(`chunk ${i}: ${'abcdefghij'.repeat(i * 100)}\n`));
+  }
+  const input = concat(chunks);
+  const results = [];
+
+  for (const format of FORMATS) {
+    await check(results, `${format} round trip`, async () => {
+      const compressed = await run(new CompressionStream(format), chunks);
+      const output = await run(new DecompressionStream(format), [compressed]);
+      console.log(`${format}: ${input.length} bytes compressed to ${compressed.length}`);
+      return equal(output, input) ? 'ok' : 'mismatch';
+    });
+
+    await check(results, `${format} split chunks`, async () => {
+      const compressed = await run(new CompressionStream(format), chunks);
+      const split = [];
+      for (let i = 0; i < compressed.length; i += 7) {
+        split.push(compressed.subarray(i, i + 7));
+      }
+      const output = await run(new DecompressionStream(format), split);
+      return equal(output, input) ? 'ok' : 'mismatch';
+    });
+
+    await check(results, `${format} empty input`, async () => {
+      const compressed = await run(new CompressionStream(format), []);
+      const output = await run(new DecompressionStream(format), [compressed]);
+      return `${compressed.length > 0 ? 'non-empty' : 'empty'} stream, ${output.length} bytes`;
+    });
+
+    await check(results, `${format} truncated input`, async () => {
+      const compressed = await run(new CompressionStream(format), chunks);
+      await run(new DecompressionStream(format), [compressed.subarray(0, compressed.length - 1)]);
+      return 'accepted';
+    });
+
+    await check(results, `${format} corrupt input`, async () => {
+      await run(new DecompressionStream(format), [encoder.encode('not compressed at all')]);
+      return 'accepted';
+    });
+
+    await check(results, `${format} native pipe`, async () => {
+      const base = url.replace(/\?.*$/, '');
+      const response = await fetch(`${base}compressed?format=${format}`);
+      const text = await response.body.pipeThrough(new DecompressionStream(format));
+      return decoder.decode(await collect(text)) === 'hello\n'.repeat(1000) + 'world\n'
+          ? 'ok' : 'mismatch';
+    });
+  }
+
+  await check(results, 'zstd reference', async () =>
+    decoder.decode(await run(new DecompressionStream('zstd'), [ZSTD_HELLO])).trim());
+  await check(results, 'zstd reference with checksum', async () =>
+    decoder.decode(await run(new DecompressionStream('zstd'), [ZSTD_HELLO_CHECKSUM])).trim());
+  await check(results, 'zstd bad checksum', async () => {
+    const corrupt = ZSTD_HELLO_CHECKSUM.slice();
+    corrupt[corrupt.length - 1] ^= 0xff;
+    await run(new DecompressionStream('zstd'), [corrupt]);
+    return 'accepted';
+  });
+  await check(results, 'zstd 8MiB window', async () =>
+    decoder.decode(await run(new DecompressionStream('zstd'), [ZSTD_WINDOW_8M])).trim());
+  await check(results, 'zstd 128MiB window', async () => {
+    await run(new DecompressionStream('zstd'), [ZSTD_WINDOW_128M]);
+    return 'accepted';
+  });
+  await check(results, 'brotli reference', async () =>
+    `${(await run(new DecompressionStream('br'), [BROTLI_EMPTY])).length} bytes`);
+  await check(results, 'brotli trailing data', async () => {
+    await run(new DecompressionStream('br'), [concat([BROTLI_EMPTY, BROTLI_EMPTY])]);
+    return 'accepted';
+  });
+  await check(results, 'unknown format', async () => {
+    new CompressionStream('xz');
+    return 'accepted';
+  });
+
+  return new Response(results.join('\n') + '\n');
+}
+
+addEventListener('fetch', (event) => { event.respondWith(handle(event)) });
@@ -0,0 +1,88 @@
+// Large enough to span several deflate blocks and exceed the largest window.
+const INPUT_SIZE = 64 * 1024;
+// Only used when requesting `?benchmark`, which logs the throughput of each level.
+const BENCHMARK_INPUT_SIZE = 4 * 1024 * 1024;
+
+// JSON-like input, which is what's most commonly compressed on the fly.
+function input(inputSize) {
+  const encoder = new TextEncoder();
+  const records = [];
+  let size = 0;
+  for (let i = 0; size < inputSize; i++) {
+    const record = JSON.stringify({ id: i, name: `item-${i % 97}`, price: (i * 37) % 1000, tags: ['a', 'b', String(i % 13)] });
+    records.push(record);
+    size += record.length + 1;
+  }
+  return encoder.encode(records.join('\n')).subarray(0, inputSize);
+}
+
+async function collect(stream) {
+  return new Uint8Array(await new Response(stream).arrayBuffer());
+}
+
+async function compress(data, options) {
+  return collect(new Blob([data]).stream().pipeThrough(new CompressionStream('gzip', options)));
+}
+
+async function decompress(data) {
+  return collect(new Blob([data]).stream().pipeThrough(new DecompressionStream('gzip')));
+}
+
+function equal(a, b) {
+  if (a.length !== b.length) {
+    return false;
+  }
+  for (let i = 0; i < a.length; i++) {
+    if (a[i] !== b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+async function benchmark() {
+  const data = input(BENCHMARK_INPUT_SIZE);
+  for (let level = 0; level <= 9; level++) {
+    const start = Date.now();
+    const compressed = await compress(data, { level });
+    const elapsed = Math.max(Date.now() - start, 1);
+    console.log(`level ${level}: ${(BENCHMARK_INPUT_SIZE / 1024 / 1024 / (elapsed / 1000)).toFixed(1)} MB/s, ` +
+                `ratio ${(BENCHMARK_INPUT_SIZE / compressed.length).toFixed(2)}`);
+  }
+  return new Response('done\n');
+}
+
+async function handle(request) {
+  if (new URL(request.url).search === '?benchmark') {
+    return benchmark();
+  }
+
+  const data = input(INPUT_SIZE);
+  const results = [];
+
+  for (let level = 0; level <= 9; level++) {
+    const roundtrip = await decompress(await compress(data, { level }));
+    results.push(`level ${level}: ${equal(roundtrip, data) ? 'ok' : 'mismatch'}`);
+  }
+
+  // The initializer script sets the default level to 6.
+  const defaults = await compress(data);
+  const level6 = await compress(data, { level: 6 });
+  results.push(`default level: ${equal(defaults, level6) ? '6' : 'not 6'}`);
+
+  const small = await compress(data, { level: 1, windowBits: 9, memLevel: 1 });
+  results.push(`small window: ${equal(await decompress(small), data) ? 'ok' : 'mismatch'}`);
+
+  for (const options of [{ level: 10 }, { windowBits: 8 }, { memLevel: 0 }, { level: 1.5 }]) {
+    try {
+      new CompressionStream('gzip', options);
+      results.push(`${JSON.stringify(options)}: accepted`);
+    } catch (e) {
+      results.push(`${JSON.stringify(options)}: ${e.name}`);
+    }
+  }
+
+  return new Response(results.join('\n') + '\n');
+}
+
+addEventListener('fetch', (event) => { event.respondWith(handle(event.request)) });
@@ -0,0 +1 @@
+setCompressionStreamDefaults({ level: 6 });
@@ -0,0 +1,64 @@
+import { get } from "eventLoopMetrics";
+
+const PLAIN = 'hello\n'.repeat(1000) + 'world\n';
+
+function taskRuns(name) {
+  const task = get().tasks[name];
+  return task ? task.count : 0;
+}
+
+// Sends `body` to the echo endpoint as an outgoing request body. Returns the echoed response, and
+// whether the body was transformed by a native BodyTransformTask instead of chunk by chunk in JS.
+async function echo(url, body) {
+  const before = taskRuns('BodyTransformTask');
+  const response = await fetch(url + 'echo', { method: 'POST', body });
+  const text = await response.text();
+  return { text, native: taskRuns('BodyTransformTask') > before };
+}
+
+async function handle(event) {
+  const url = event.request.url;
+  if (url.endsWith('/plain')) {
+    return new Response(PLAIN);
+  }
+  if (url.endsWith('/compressed')) {
+    const response = await fetch(url.replace(/compressed$/, 'plain'));
+    return new Response(response.body.pipeThrough(new CompressionStream('gzip')));
+  }
+  if (url.endsWith('/echo')) {
+    return new Response(event.request.body);
+  }
+
+  let compressed = await fetch(url + 'compressed');
+  const decompressed = await echo(url, compressed.body.pipeThrough(new DecompressionStream('gzip')));
+
+  // A chain of native transforms is applied by a single task, too.
+  compressed = await fetch(url + 'compressed');
+  const recompressed = await echo(url, compressed.body
+    .pipeThrough(new DecompressionStream('gzip'))
+    .pipeThrough(new CompressionStream('deflate'))
+    .pipeThrough(new DecompressionStream('deflate')));
+
+  // Responses that are read from JS instead of being sent have no outgoing body to write to, so
+  // their streams are piped in JS.
+  compressed = await fetch(url + 'compressed');
+  let before = taskRuns('BodyTransformTask');
+  let text = await new Response(compressed.body.pipeThrough(new DecompressionStream('gzip'))).text();
+  const readInJS = { text, native: taskRuns('BodyTransformTask') > before };
+
+  const plain = await fetch(url + 'plain');
+  before = taskRuns('BodyAppendTask');
+  text = await new Response(plain.body.pipeThrough(new TransformStream())).text();
+  const identityInJS = { text, native: taskRuns('BodyAppendTask') > before };
+
+  return new Response([
+    ['decompressed', decompressed],
+    ['recompressed', recompressed],
+    ['decompressed and read in JS', readInJS],
+    ['identity stream read in JS', identityInJS],
+  ].map(([name, result]) =>
+    `${name}: ${result.text === PLAIN ? 'ok' : 'mismatch'}, ${result.native ? 'native' : 'in JS'}\n`
+  ).join(''));
+}
+
+addEventListener('fetch', (event) => { event.respondWith(handle(event)) });
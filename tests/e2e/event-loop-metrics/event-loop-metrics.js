@@ -0,0 +1,11 @@
+import { get } from "eventLoopMetrics";
+
+async function handle(event) {
+  await new Promise(resolve => setTimeout(resolve, 1));
+  await new Promise(resolve => setTimeout(resolve, 1));
+  const metrics = get();
+  return new Response(`${metrics.turns >= 2} ${metrics.blockingPolls >= 2} ${metrics.tasks.TimerTask.count}`);
+}
+
+//@ts-ignore
+addEventListener('fetch', (event) => { event.respondWith(handle(event)) });
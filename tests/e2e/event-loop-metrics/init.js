@@ -0,0 +1 @@
+defineBuiltinModule('eventLoopMetrics', { get: eventLoopMetrics });
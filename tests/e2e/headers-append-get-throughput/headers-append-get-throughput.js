@@ -0,0 +1,29 @@
+// Interleaves appends with lookups, which used to re-sort the whole list for every lookup.
+// Only logs timings: the response body just checks that the lookups found the right values.
+function interleavedAppendGet(count) {
+  const headers = new Headers();
+  let found = 0;
+  const start = performance.now();
+  for (let i = 0; i < count; i++) {
+    headers.append(`x-header-${i}`, String(i));
+    if (headers.get(`x-header-${i >> 1}`) === String(i >> 1)) {
+      found++;
+    }
+  }
+  return { elapsed: performance.now() - start, found };
+}
+
+function handle() {
+  // Warm up, so that the first measurement doesn't include JIT or allocator setup.
+  interleavedAppendGet(1000);
+
+  const results = [];
+  for (const count of [1000, 8000]) {
+    const { elapsed, found } = interleavedAppendGet(count);
+    console.log(`${count} interleaved appends and gets took ${elapsed.toFixed(1)}ms`);
+    results.push(`${count}: ${found === count ? 'ok' : `${found} found`}`);
+  }
+  return new Response(results.join('\n') + '\n');
+}
+
+addEventListener('fetch', (event) => { event.respondWith(handle()) });
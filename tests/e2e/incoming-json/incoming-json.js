@@ -0,0 +1,26 @@
+addEventListener('fetch', async (event) => {
+  try {
+    if (event.request.url.endsWith('/nested')) {
+      // A BOM, followed by JSON with multi-byte characters split across chunks.
+      let bytes = new TextEncoder().encode('\uFEFF{"greeting":"grüße","symbol":"€😀"}');
+      let body = new ReadableStream({
+        start(controller) {
+          for (let i = 0; i < bytes.length; i += 3) {
+            controller.enqueue(bytes.slice(i, i + 3));
+          }
+          controller.close();
+        }
+      });
+      event.respondWith(new Response(body));
+      return;
+    }
+
+    let resolve;
+    event.respondWith(new Promise((r) => resolve = r));
+    let json = await (await fetch(event.request.url + 'nested')).json();
+    let text = await (await fetch(event.request.url + 'nested')).text();
+    resolve(new Response(`${json.greeting} ${json.symbol} ${text.length} ${text.codePointAt(0)}`));
+  } catch (e) {
+    console.error(e);
+  }
+});
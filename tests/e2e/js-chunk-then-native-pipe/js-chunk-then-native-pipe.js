@@ -0,0 +1,46 @@
+addEventListener('fetch', async (event) => {
+  try {
+    let url = new URL(event.request.url);
+    if (url.pathname === '/upstream') {
+      event.respondWith(new Response('upstream\n'));
+      return;
+    }
+
+    let resolve;
+    event.respondWith(new Promise((r) => resolve = r));
+    let upstream = await fetch(new URL('/upstream', url));
+    let encoder = new TextEncoder();
+
+    if (url.pathname === '/gzip') {
+      // The leading chunk is compressed in JS, the upstream body natively.
+      let stream = new CompressionStream('gzip');
+      resolve(new Response(stream.readable));
+      await writeThenPipe(stream.writable, encoder.encode('transformed: '), upstream.body);
+      return;
+    }
+
+    if (url.pathname === '/plain') {
+      let { readable, writable } = new TransformStream();
+      resolve(new Response(readable));
+      await writeThenPipe(writable, encoder.encode('appended: '), upstream.body);
+      return;
+    }
+
+    let plain = await fetch(new URL('/plain', url));
+    let gzip = await fetch(new URL('/gzip', url));
+    let text = await plain.text();
+    text += await new Response(gzip.body.pipeThrough(new DecompressionStream('gzip'))).text();
+    resolve(new Response(text));
+  } catch (e) {
+    console.error(e);
+  }
+});
+
+// Writes a chunk from JS, then pipes `body` into the same writable. The chunk has to end up in
+// front of the piped body, even if it's still buffered when the native pipe starts.
+async function writeThenPipe(writable, chunk, body) {
+  let writer = writable.getWriter();
+  await writer.write(chunk);
+  writer.releaseLock();
+  await body.pipeTo(writable);
+}
@@ -0,0 +1,16 @@
+addEventListener('fetch', (event) => {
+  const encoder = new TextEncoder();
+  const body = new ReadableStream({
+    start(controller) {
+      for (let i = 0; i < 5000; i++) {
+        controller.enqueue(encoder.encode(`${i}\n`));
+        // Interleave a chunk larger than the body's write buffer.
+        if (i === 2500) {
+          controller.enqueue(encoder.encode('x'.repeat(70000) + '\n'));
+        }
+      }
+      controller.close();
+    }
+  });
+  event.respondWith(new Response(body));
+});
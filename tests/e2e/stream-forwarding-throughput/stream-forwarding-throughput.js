@@ -0,0 +1,50 @@
+import { get } from "eventLoopMetrics";
+
+const BODY_SIZE = 8 * 1024 * 1024;
+const CHUNK_SIZE = 64 * 1024;
+
+function largeBody() {
+  const chunk = new Uint8Array(CHUNK_SIZE).map((_, i) => i & 0xff);
+  let sent = 0;
+  return new ReadableStream({
+    pull(controller) {
+      controller.enqueue(chunk.slice());
+      sent += CHUNK_SIZE;
+      if (sent >= BODY_SIZE) {
+        controller.close();
+      }
+    }
+  });
+}
+
+async function handle(event) {
+  const url = event.request.url;
+  if (url.endsWith('/large')) {
+    return new Response(largeBody());
+  }
+  if (url.endsWith('/sink')) {
+    const body = await event.request.arrayBuffer();
+    return new Response(String(body.byteLength));
+  }
+
+  // Forward the large body to the sink through an identity TransformStream, which appends it to
+  // the outgoing request body on the host side.
+  const start = Date.now();
+  const large = await fetch(url + 'large');
+  const sink = await fetch(url + 'sink', {
+    method: 'POST',
+    body: large.body.pipeThrough(new TransformStream()),
+  });
+  const received = await sink.text();
+  const elapsed = Math.max(Date.now() - start, 1);
+
+  // Event loop runs of the append task, each of which splices until a stream would block. The
+  // number of host calls made by those runs isn't tracked.
+  const append = get().tasks.BodyAppendTask;
+  console.log(`Forwarded ${received} bytes in ${elapsed}ms ` +
+              `(${(BODY_SIZE / 1024 / 1024 / (elapsed / 1000)).toFixed(1)} MB/s), ` +
+              `${append ? append.count : 0} BodyAppendTask runs taking ${append ? append.sum : 0}us`);
+  return new Response(`${received}\n`);
+}
+
+addEventListener('fetch', (event) => { event.respondWith(handle(event)) });
@@ -0,0 +1,99 @@
+import { serveTest } from '../test-server.js';
+import { strictEqual, deepStrictEqual, throws } from '../../assert.js';
+
+export const handler = serveTest(async (t) => {
+  t.test('interleaved-mutations-keep-order', () => {
+    const headers = new Headers();
+    headers.append('b', '1');
+    strictEqual(headers.get('b'), '1');
+    headers.append('A', '2');
+    strictEqual(headers.get('a'), '2');
+    headers.append('b', '3');
+    strictEqual(headers.get('B'), '1, 3');
+    headers.append('set-cookie', 'x=1');
+    headers.append('c', '4');
+    headers.append('Set-Cookie', 'y=2');
+    deepStrictEqual([...headers], [
+      ['a', '2'], ['b', '1, 3'], ['c', '4'], ['set-cookie', 'x=1'], ['set-cookie', 'y=2'],
+    ]);
+    headers.set('b', '5');
+    strictEqual(headers.get('b'), '5');
+    headers.delete('a');
+    strictEqual(headers.has('a'), false);
+    headers.append('a', '6');
+    deepStrictEqual([...headers], [
+      ['a', '6'], ['b', '5'], ['c', '4'], ['set-cookie', 'x=1'], ['set-cookie', 'y=2'],
+    ]);
+    deepStrictEqual(headers.getSetCookie(), ['x=1', 'y=2']);
+  });
+
+  t.test('clones-are-independent', () => {
+    const request = new Request('https://example.com', { headers: { a: '1', b: '2' } });
+    const clone = request.clone();
+    const copy = new Headers(clone.headers);
+    clone.headers.set('a', '3');
+    copy.append('c', '4');
+    deepStrictEqual([...request.headers], [['a', '1'], ['b', '2']]);
+    deepStrictEqual([...clone.headers], [['a', '3'], ['b', '2']]);
+    deepStrictEqual([...copy], [['a', '1'], ['b', '2'], ['c', '4']]);
+    request.headers.delete('b');
+    deepStrictEqual([...request.headers], [['a', '1']]);
+    deepStrictEqual([...copy], [['a', '1'], ['b', '2'], ['c', '4']]);
+  });
+
+  t.test('shared-headers-respect-guard', () => {
+    const headers = new Headers({ 'connection': 'close', 'x-a': '1' });
+    const response = new Response(null, { headers });
+    deepStrictEqual([...response.headers], [['x-a', '1']]);
+    const request = new Request('https://example.com', { headers: response.headers });
+    deepStrictEqual([...request.headers], [['x-a', '1']]);
+    deepStrictEqual([...headers], [['connection', 'close'], ['x-a', '1']]);
+  });
+
+  t.test('byte-string-values', () => {
+    const headers = new Headers();
+    const long = 'caf\xe9 '.repeat(20).trim();
+    headers.set('x-short', '\xff');
+    headers.set('x-long', long);
+    strictEqual(headers.get('x-short'), '\xff');
+    strictEqual(headers.get('x-long'), long);
+    throws(() => headers.set('x-wide', 'abcd\u0100'), TypeError);
+    throws(() => headers.set('x-wide', '\u20ac'), TypeError);
+    strictEqual(headers.has('x-wide'), false);
+  });
+
+  t.test('cached-values-follow-mutations', () => {
+    const headers = new Headers([['a', '1'], ['b', '2'], ['b', '3'], ['c', '4']]);
+    strictEqual(headers.get('b'), '2, 3');
+    strictEqual(headers.get('b'), '2, 3');
+    strictEqual(headers.get('c'), '4');
+    headers.append('b', '5');
+    strictEqual(headers.get('b'), '2, 3, 5');
+    strictEqual(headers.get('c'), '4');
+    headers.delete('a');
+    strictEqual(headers.get('b'), '2, 3, 5');
+    strictEqual(headers.get('c'), '4');
+    deepStrictEqual([...headers.values()], ['2, 3, 5', '4']);
+    const copy = new Headers(headers);
+    copy.set('c', '6');
+    strictEqual(headers.get('c'), '4');
+    strictEqual(copy.get('c'), '6');
+  });
+
+  t.test('set-cookie-values-are-cached-separately', () => {
+    const headers = new Headers();
+    headers.append('set-cookie', 'a=1');
+    headers.append('x-b', '2');
+    headers.append('Set-Cookie', 'c=3, d=4');
+    const cookies = headers.getSetCookie();
+    deepStrictEqual(cookies, ['a=1', 'c=3, d=4']);
+    cookies.push('e=5');
+    deepStrictEqual(headers.getSetCookie(), ['a=1', 'c=3, d=4']);
+    strictEqual(headers.get('set-cookie'), 'a=1, c=3, d=4');
+    deepStrictEqual([...headers], [['set-cookie', 'a=1'], ['set-cookie', 'c=3, d=4'], ['x-b', '2']]);
+    headers.append('set-cookie', 'f=6');
+    deepStrictEqual(headers.getSetCookie(), ['a=1', 'c=3, d=4', 'f=6']);
+    headers.delete('set-cookie');
+    deepStrictEqual(headers.getSetCookie(), []);
+  });
+});
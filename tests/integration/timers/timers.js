@@ -41,6 +41,32 @@ export const handler = serveTest(async (t) => {
       }
     });
   });
+  await t.asyncTest("setTimeout-many-run-in-order", (resolve, reject) => {
+    const order = [];
+    const cleared = [];
+    for (let i = 0; i < 1000; i++) {
+      const id = setTimeout(() => order.push(i), 5);
+      if (i % 3 === 0) {
+        cleared.push(id);
+      }
+    }
+    for (const id of cleared) {
+      clearTimeout(id);
+    }
+    setTimeout(() => {
+      try {
+        strictEqual(order.length, 1000 - cleared.length, 'cleared timers must not run');
+        for (let i = 0; i < order.length; i++) {
+          assert(order[i] % 3 !== 0, 'cleared timers must not run');
+          assert(i === 0 || order[i - 1] < order[i], 'timers should run in the order they were set');
+        }
+      } catch (e) {
+        reject(e);
+        return;
+      }
+      resolve();
+    }, 10);
+  });
   await t.asyncTest("setTimeout-cleared-in-callback", (resolve, reject) => {
     let id = setTimeout.call(undefined, () => {
       clearTimeout(id);
@@ -46,6 +46,8 @@ endfunction()
 test_e2e(blob)
 test_e2e(eventloop-stall)
 test_e2e(headers)
+test_e2e(headers-append-get-throughput)
+test_e2e(header-validation-throughput)
 test_e2e(runtime-err)
 test_e2e(smoke)
 test_e2e(syntax-err)
@@ -53,11 +55,20 @@ test_e2e(tla-err)
 test_e2e(tla-runtime-resolve)
 test_e2e(tla)
 test_e2e(stream-forwarding)
+test_e2e(stream-forwarding-throughput)
+test_e2e(body-stream-upload)
 test_e2e(multi-stream-forwarding)
+test_e2e(js-chunk-then-native-pipe)
 test_e2e(teed-stream-as-outgoing-body)
+test_e2e(compression-stream-forwarding)
+test_e2e(compression-levels)
+test_e2e(compression-formats)
 test_e2e(init-script)
 test_e2e(no-init-location)
 test_e2e(init-location)
+test_e2e(event-loop-metrics)
+test_e2e(many-small-chunks)
+test_e2e(incoming-json)
 
 integration_tests(
     blob
@@ -65,6 +76,7 @@ integration_tests(
     crypto
     event
     fetch
+    headers
     performance
     timers
 )
@@ -42,7 +42,8 @@ static bool evalScript(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
   JS::SourceText<mozilla::Utf8Unit> source;
-  MOZ_RELEASE_ASSERT(source.init(cx, std::move(script.ptr), script.len));
+  size_t script_len = script.len;
+  MOZ_RELEASE_ASSERT(source.init(cx, script.release(), script_len));
   JS::CompileOptions options(cx);
   options.setNonSyntacticScope(true);
   return Evaluate(cx, options, source, args.rval());